@@ -0,0 +1,712 @@
+#include "pch.h"
+#include "../abci/abci.h"
+#include "MeshGenerator.h"
+#include "Test.h"
+
+
+// one mesh with normals, uv0 and colors. only the points of the upper part move, so most vertices of a frame are the
+// same as in the frame before. num_frames 1 makes a constant mesh
+static void WriteTestMesh(const char *path, int num_frames, int iteration, float frame_rate = 30.0f)
+{
+    std::vector<int> counts, indices;
+    std::vector<float3> points;
+    std::vector<float2> uv;
+    GenerateIcoSphereMesh(counts, indices, points, uv, 0.5f, iteration);
+
+    std::vector<float3> normals(points.size());
+    std::vector<float4> colors(points.size());
+    for (size_t pi = 0; pi < points.size(); ++pi)
+    {
+        normals[pi] = normalize(points[pi]);
+        colors[pi] = { points[pi].y + 0.5f, 0.25f, 1.0f, 1.0f };
+    }
+
+    aeSubmeshData submesh;
+    submesh.indices = indices.data();
+    submesh.index_count = (int)indices.size();
+    submesh.topology = aeTopology::Triangles;
+
+    aeConfig config;
+    config.frame_rate = frame_rate;
+
+    auto ctx = aeCreateContext();
+    aeSetConfig(ctx, &config);
+    aeOpenArchive(ctx, path);
+    auto mesh = aeNewPolyMesh(aeNewXform(aeGetTopObject(ctx), "Sphere"), "Mesh");
+
+    std::vector<float3> animated(points);
+    for (int fi = 0; fi < num_frames; ++fi)
+    {
+        float s = 1.0f + 0.5f * std::sin((float)fi * 0.3f);
+        for (size_t pi = 0; pi < points.size(); ++pi)
+        {
+            if (points[pi].y > 0.25f)
+                animated[pi] = points[pi] * s;
+        }
+
+        aePolyMeshData data;
+        data.points = (abcV3*)animated.data();
+        data.point_count = (int)animated.size();
+        data.normals = (abcV3*)normals.data();
+        data.uv0 = (abcV2*)uv.data();
+        data.colors = (abcV4*)colors.data();
+        data.submeshes = &submesh;
+        data.submesh_count = 1;
+
+        aeMarkFrameBegin(ctx);
+        aePolyMeshWriteSample(mesh, &data);
+        aeMarkFrameEnd(ctx);
+    }
+    aeDestroyContext(ctx);
+}
+
+static aiPolyMesh* FindPolyMesh(aiObject *obj)
+{
+    if (auto mesh = aiObjectAsPolyMesh(obj))
+        return mesh;
+    int num_children = aiObjectGetNumChildren(obj);
+    for (int ci = 0; ci < num_children; ++ci)
+    {
+        if (auto mesh = FindPolyMesh(aiObjectGetChild(obj, ci)))
+            return mesh;
+    }
+    return nullptr;
+}
+
+// bytes aiPolyMeshData receives per vertex of an attribute
+static int FillElementSize(aiVertexAttribute attribute, const aiVertexFormat& format)
+{
+    switch (attribute)
+    {
+    case aiVertexAttribute::Normals: return format.normals == aiAttributeFormat::Oct16 ? 4 : 12;
+    case aiVertexAttribute::Tangents: return format.tangents == aiAttributeFormat::Oct16 ? 8 : 16;
+    case aiVertexAttribute::UV0:
+    case aiVertexAttribute::UV1: return format.uv == aiAttributeFormat::Half16 ? 4 : 8;
+    case aiVertexAttribute::RGBA:
+    case aiVertexAttribute::RGB: return format.colors == aiAttributeFormat::UNorm8 ? 4 : 16;
+    default: return 12;
+    }
+}
+
+const int FillAttributeCount = (int)aiVertexAttribute::RGB + 1;
+
+// every split and submesh of the current sample, filled through aiPolyMeshFillVertexBuffer()
+struct FilledSample
+{
+    std::vector<aiMeshSplitSummary> splits;
+    std::vector<aiSubmeshSummary> submeshes;
+    std::vector<char> attributes[FillAttributeCount]; // all splits one after another. empty if the mesh doesn't have it
+    std::vector<char> indices; // all submeshes one after another
+    std::vector<abcV3> centers, extents; // per split
+
+    // the attribute of split split_index
+    char* at(int attribute, int split_index, const aiVertexFormat& format)
+    {
+        auto& a = attributes[attribute];
+        if (a.empty())
+            return nullptr;
+        return a.data() + (size_t)splits[split_index].vertex_offset * FillElementSize((aiVertexAttribute)attribute, format);
+    }
+};
+
+// destinations of aiPolyMeshFillVertexBuffer() in the buffers of dst
+static void GetFillBuffers(FilledSample& dst, const aiVertexFormat& format,
+    std::vector<aiPolyMeshData>& vbs, std::vector<aiSubmeshData>& ibs)
+{
+    vbs.resize(dst.splits.size());
+    for (int si = 0; si < (int)vbs.size(); ++si)
+    {
+        auto& vb = vbs[si];
+        vb.points = (abcV3*)dst.at(0, si, format);
+        vb.velocities = (abcV3*)dst.at(1, si, format);
+        vb.normals = (abcV3*)dst.at(2, si, format);
+        vb.tangents = (abcV4*)dst.at(3, si, format);
+        vb.uv0 = (abcV2*)dst.at(4, si, format);
+        vb.uv1 = (abcV2*)dst.at(5, si, format);
+        vb.rgba = (abcV4*)dst.at(6, si, format);
+        vb.rgb = (abcV4*)dst.at(7, si, format);
+    }
+
+    ibs.resize(dst.submeshes.size());
+    for (size_t smi = 0, offset = 0; smi < ibs.size(); ++smi)
+    {
+        ibs[smi].indices = dst.indices.data() + offset;
+        offset += (size_t)dst.submeshes[smi].index_count * dst.submeshes[smi].index_size;
+    }
+}
+
+static void FillSample(FilledSample& dst, aiPolyMesh *mesh, const aiVertexFormat& format)
+{
+    aiMeshSummary summary;
+    aiPolyMeshGetSummary(mesh, &summary);
+    auto sample = aiSchemaGetSample(mesh);
+    aiMeshSampleSummary sample_summary;
+    aiPolyMeshGetSampleSummary(sample, &sample_summary);
+    dst.splits.resize(sample_summary.split_count);
+    dst.submeshes.resize(sample_summary.submesh_count);
+    aiPolyMeshGetSplitSummaries(sample, dst.splits.data());
+    aiPolyMeshGetSubmeshSummaries(sample, dst.submeshes.data());
+
+    bool has[FillAttributeCount] = {
+        summary.has_points, summary.has_velocities, summary.has_normals, summary.has_tangents,
+        summary.has_uv0, summary.has_uv1, summary.has_rgba, summary.has_rgb,
+    };
+    for (int ai = 0; ai < FillAttributeCount; ++ai)
+    {
+        size_t size = has[ai] ? (size_t)sample_summary.vertex_count * FillElementSize((aiVertexAttribute)ai, format) : 0;
+        dst.attributes[ai].assign(size, 0);
+    }
+
+    size_t index_bytes = 0;
+    for (auto& sm : dst.submeshes)
+        index_bytes += (size_t)sm.index_count * sm.index_size;
+    dst.indices.assign(index_bytes, 0);
+
+    std::vector<aiPolyMeshData> vbs;
+    std::vector<aiSubmeshData> ibs;
+    GetFillBuffers(dst, format, vbs, ibs);
+    aiPolyMeshFillVertexBuffer(sample, vbs.data(), ibs.data());
+
+    dst.centers.clear();
+    dst.extents.clear();
+    for (auto& vb : vbs)
+    {
+        dst.centers.push_back(vb.center);
+        dst.extents.push_back(vb.extents);
+    }
+}
+
+static bool SameFill(const FilledSample& a, const FilledSample& b)
+{
+    static const char *names[FillAttributeCount] = { "points", "velocities", "normals", "tangents", "uv0", "uv1", "rgba", "rgb" };
+
+    // no short circuit, to report every output that differs
+    bool ret = true;
+    for (int ai = 0; ai < FillAttributeCount; ++ai)
+    {
+        if (a.attributes[ai] != b.attributes[ai])
+        {
+            Print("      %s differ\n", names[ai]);
+            ret = false;
+        }
+    }
+    if (a.indices != b.indices)
+    {
+        Print("      indices differ\n");
+        ret = false;
+    }
+    return ret;
+}
+
+static aiContext* LoadTestMesh(int uid, const char *path, const aiConfig& config, aiPolyMesh *&mesh)
+{
+    auto ctx = aiContextCreate(uid);
+    aiContextSetConfig(ctx, &config);
+    mesh = nullptr;
+    if (aiContextLoad(ctx, path))
+        mesh = FindPolyMesh(aiContextGetTopObject(ctx));
+    if (!mesh)
+    {
+        Print("    failed to load %s\n", path);
+        aiContextDestroy(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+
+// writes many animated meshes and measures how fast aiContextUpdateSamples() reads them back with varying stream count.
+TestCase(ImportAlembic_StreamCount)
+{
+    const char *path = "StreamCount.abc";
+    const int num_meshes = 64;
+    const int num_frames = 60;
+    const float frame_rate = 30.0f;
+
+    {
+        std::vector<int> counts, indices;
+        std::vector<float3> points;
+        std::vector<float2> uv;
+        GenerateIcoSphereMesh(counts, indices, points, uv, 0.5f, 5);
+
+        aeSubmeshData submesh;
+        submesh.indices = indices.data();
+        submesh.index_count = (int)indices.size();
+        submesh.topology = aeTopology::Triangles;
+
+        aeConfig config;
+        config.frame_rate = frame_rate;
+
+        auto ctx = aeCreateContext();
+        aeSetConfig(ctx, &config);
+        aeOpenArchive(ctx, path);
+
+        auto top = aeGetTopObject(ctx);
+        std::vector<aePolyMesh*> meshes;
+        for (int mi = 0; mi < num_meshes; ++mi)
+        {
+            char name[64];
+            sprintf(name, "Sphere%d", mi);
+            meshes.push_back(aeNewPolyMesh(aeNewXform(top, name), "Mesh"));
+        }
+
+        std::vector<float3> animated(points.size());
+        for (int fi = 0; fi < num_frames; ++fi)
+        {
+            aeMarkFrameBegin(ctx);
+            for (int mi = 0; mi < num_meshes; ++mi)
+            {
+                float s = 1.0f + 0.5f * std::sin((float)(fi + mi) * 0.1f);
+                for (size_t pi = 0; pi < points.size(); ++pi)
+                    animated[pi] = points[pi] * s;
+
+                aePolyMeshData data;
+                data.points = (abcV3*)animated.data();
+                data.point_count = (int)animated.size();
+                data.uv0 = (abcV2*)uv.data();
+                data.submeshes = &submesh;
+                data.submesh_count = 1;
+                aePolyMeshWriteSample(meshes[mi], &data);
+            }
+            aeMarkFrameEnd(ctx);
+        }
+        aeDestroyContext(ctx);
+    }
+
+    int stream_counts[] = { 1, 2, 4, 8 };
+    for (int num_streams : stream_counts)
+    {
+        aiConfig config;
+        config.worker_count = 0;
+        config.stream_count = num_streams;
+        config.interpolate_samples = false;
+
+        auto ctx = aiContextCreate(num_streams);
+        aiContextSetConfig(ctx, &config);
+        if (!aiContextLoad(ctx, path))
+        {
+            Print("    failed to load %s\n", path);
+            aiContextDestroy(ctx);
+            return;
+        }
+
+        char name[64];
+        sprintf(name, "%d stream(s)", num_streams);
+        float begin = Now();
+        TestScope(name, [&]() {
+            for (int fi = 0; fi < num_frames; ++fi)
+                aiContextUpdateSamples(ctx, (double)fi / frame_rate);
+        });
+        float elapsed = Now() - begin;
+        Print("    %.1f mesh samples/s\n", (float)(num_meshes * num_frames) / (elapsed / 1000.0f));
+
+        aiContextDestroy(ctx);
+    }
+}
+
+// switches aiConfig::vertex_format of a loaded constant mesh, which is not cooked again otherwise. the fills must be
+// the same as those of a context that was loaded with the format
+TestCase(ImportAlembic_VertexFormat)
+{
+    const char *path = "VertexFormat.abc";
+    WriteTestMesh(path, 1, 5);
+
+    aiVertexFormat encoded;
+    encoded.normals = encoded.tangents = aiAttributeFormat::Oct16;
+    encoded.uv = aiAttributeFormat::Half16;
+    encoded.colors = aiAttributeFormat::UNorm8;
+    aiVertexFormat formats[] = { encoded, aiVertexFormat(), encoded };
+    const char *names[] = { "to encoded", "to float", "to encoded again" };
+
+    aiConfig config;
+    config.tangents_mode = TangentsMode::Compute;
+    aiPolyMesh *mesh;
+    auto ctx = LoadTestMesh(1, path, config, mesh);
+    if (!ctx)
+        return;
+    aiContextUpdateSamples(ctx, 0.0);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        config.vertex_format = formats[i];
+        aiContextSetConfig(ctx, &config);
+        aiContextUpdateSamples(ctx, 0.0);
+        FilledSample switched;
+        FillSample(switched, mesh, config.vertex_format);
+
+        aiPolyMesh *fresh_mesh;
+        auto fresh = LoadTestMesh(2, path, config, fresh_mesh);
+        if (!fresh)
+            break;
+        aiContextUpdateSamples(fresh, 0.0);
+        FilledSample expected;
+        FillSample(expected, fresh_mesh, config.vertex_format);
+        aiContextDestroy(fresh);
+
+        Print("    %s: %s\n", names[i], SameFill(switched, expected) ? "ok" : "mismatch");
+    }
+    aiContextDestroy(ctx);
+}
+
+// split bounds of each aiBoundsMode against the bounds of the filled points, on an animated mesh
+TestCase(ImportAlembic_SplitBounds)
+{
+    const char *path = "SplitBounds.abc";
+    const int num_frames = 10;
+    const float frame_rate = 30.0f;
+    WriteTestMesh(path, num_frames, 5, frame_rate);
+
+    aiConfig config;
+    config.interpolate_samples = false;
+    aiPolyMesh *mesh;
+    auto ctx = LoadTestMesh(1, path, config, mesh);
+    if (!ctx)
+        return;
+
+    aiBoundsMode modes[] = { aiBoundsMode::ComputeOnFill, aiBoundsMode::ComputeOnCook, aiBoundsMode::ArchiveIfPossible };
+    const char *names[] = { "ComputeOnFill", "ComputeOnCook", "ArchiveIfPossible" };
+    for (int mi = 0; mi < 3; ++mi)
+    {
+        config.bounds_mode = modes[mi];
+        aiContextSetConfig(ctx, &config);
+
+        // archive bounds are stored as doubles in the file's space
+        float max_error = 0.0f;
+        for (int fi = 0; fi < num_frames; ++fi)
+        {
+            aiContextUpdateSamples(ctx, (double)fi / frame_rate);
+            FilledSample filled;
+            FillSample(filled, mesh, config.vertex_format);
+            for (size_t si = 0; si < filled.splits.size(); ++si)
+            {
+                auto *points = (const abcV3*)filled.at(0, (int)si, config.vertex_format);
+                int num_points = filled.splits[si].vertex_count;
+                abcV3 bmin = points[0], bmax = points[0];
+                for (int pi = 1; pi < num_points; ++pi)
+                {
+                    auto& p = points[pi];
+                    bmin = { std::min(bmin.x, p.x), std::min(bmin.y, p.y), std::min(bmin.z, p.z) };
+                    bmax = { std::max(bmax.x, p.x), std::max(bmax.y, p.y), std::max(bmax.z, p.z) };
+                }
+                auto& c = filled.centers[si];
+                auto& e = filled.extents[si];
+                max_error = std::max({ max_error,
+                    std::abs(c.x - (bmin.x + bmax.x) * 0.5f), std::abs(c.y - (bmin.y + bmax.y) * 0.5f),
+                    std::abs(c.z - (bmin.z + bmax.z) * 0.5f), std::abs(e.x - (bmax.x - bmin.x)),
+                    std::abs(e.y - (bmax.y - bmin.y)), std::abs(e.z - (bmax.z - bmin.z)) });
+            }
+        }
+        Print("    %s: %s (max error %g)\n", names[mi], max_error < 1e-5f ? "ok" : "mismatch", max_error);
+    }
+    aiContextDestroy(ctx);
+}
+
+// fills interleaved streams of float and encoded elements, and compares each element with aiPolyMeshFillVertexBuffer()
+// of a context whose aiConfig::vertex_format is the element's format. the mesh is large enough to fill on workers
+TestCase(ImportAlembic_SplitStream)
+{
+    const char *path = "SplitStream.abc";
+    const int num_frames = 3;
+    const float frame_rate = 30.0f;
+    WriteTestMesh(path, num_frames, 7, frame_rate);
+
+    aiVertexFormat encoded;
+    encoded.normals = encoded.tangents = aiAttributeFormat::Oct16;
+    encoded.uv = aiAttributeFormat::Half16;
+    encoded.colors = aiAttributeFormat::UNorm8;
+
+    aiConfig config;
+    config.worker_count = 0;
+    config.interpolate_samples = false;
+    config.tangents_mode = TangentsMode::Compute;
+    aiPolyMesh *mesh;
+    auto ctx = LoadTestMesh(1, path, config, mesh);
+    if (!ctx)
+        return;
+    aiConfig encoded_config = config;
+    encoded_config.vertex_format = encoded;
+    aiPolyMesh *encoded_mesh;
+    auto encoded_ctx = LoadTestMesh(2, path, encoded_config, encoded_mesh);
+    if (!encoded_ctx)
+    {
+        aiContextDestroy(ctx);
+        return;
+    }
+
+    struct Layout
+    {
+        const char *name;
+        std::vector<aiVertexElement> elements;
+        int stride;
+    };
+    auto element = [](aiVertexAttribute a, aiAttributeFormat f, int offset) {
+        aiVertexElement e;
+        e.attribute = a;
+        e.format = f;
+        e.offset = offset;
+        return e;
+    };
+    Layout layouts[] = {
+        { "float", {
+            element(aiVertexAttribute::Points, aiAttributeFormat::Float32, 0),
+            element(aiVertexAttribute::Normals, aiAttributeFormat::Float32, 12),
+            element(aiVertexAttribute::Tangents, aiAttributeFormat::Float32, 24),
+            element(aiVertexAttribute::UV0, aiAttributeFormat::Float32, 40),
+            element(aiVertexAttribute::RGBA, aiAttributeFormat::Float32, 48),
+        }, 64 },
+        { "encoded", {
+            element(aiVertexAttribute::Points, aiAttributeFormat::Float32, 0),
+            element(aiVertexAttribute::Normals, aiAttributeFormat::Oct16, 12),
+            element(aiVertexAttribute::Tangents, aiAttributeFormat::Oct16, 16),
+            element(aiVertexAttribute::UV0, aiAttributeFormat::Half16, 24),
+            element(aiVertexAttribute::RGBA, aiAttributeFormat::UNorm8, 28),
+        }, 32 },
+    };
+
+    for (int fi = 0; fi < num_frames; ++fi)
+    {
+        double time = (double)fi / frame_rate;
+        aiContextUpdateSamples(ctx, time);
+        aiContextUpdateSamples(encoded_ctx, time);
+        FilledSample filled[2];
+        FillSample(filled[0], mesh, config.vertex_format);
+        FillSample(filled[1], encoded_mesh, encoded);
+        const aiVertexFormat *formats[2] = { &config.vertex_format, &encoded };
+
+        for (int li = 0; li < 2; ++li)
+        {
+            auto& layout = layouts[li];
+            for (auto& e : layout.elements)
+                e.stride = layout.stride;
+            auto& expected = filled[li];
+            auto& format = *formats[li];
+
+            bool same = true;
+            for (int si = 0; si < (int)expected.splits.size(); ++si)
+            {
+                int num_vertices = expected.splits[si].vertex_count;
+                std::vector<char> stream((size_t)num_vertices * layout.stride);
+                aiVertexStreamData data;
+                data.data = stream.data();
+                data.elements = layout.elements.data();
+                data.element_count = (int)layout.elements.size();
+                aiPolyMeshFillSplitStream(aiSchemaGetSample(mesh), si, &data);
+
+                for (auto& e : layout.elements)
+                {
+                    int size = FillElementSize(e.attribute, format);
+                    const char *src = expected.at((int)e.attribute, si, format);
+                    for (int vi = 0; same && src && vi < num_vertices; ++vi)
+                        same = memcmp(stream.data() + e.offset + (size_t)vi * e.stride, src + (size_t)vi * size, size) == 0;
+                }
+                same = same && memcmp(&data.center, &expected.centers[si], sizeof(abcV3)) == 0 &&
+                    memcmp(&data.extents, &expected.extents[si], sizeof(abcV3)) == 0;
+            }
+            Print("    frame %d, %s: %s (%d splits)\n", fi, layout.name, same ? "ok" : "mismatch", (int)expected.splits.size());
+        }
+    }
+    aiContextDestroy(encoded_ctx);
+    aiContextDestroy(ctx);
+}
+
+// the views of a sample against what aiPolyMeshFillVertexBuffer() wrote for it. rgb views are not widened, so only
+// the bytes a view has per element are compared
+static bool SameViews(aiPolyMeshSample *sample, FilledSample& expected, const aiVertexFormat& format)
+{
+    bool same = true;
+    for (int si = 0; si < (int)expected.splits.size(); ++si)
+    {
+        aiPolyMeshSplitView view;
+        aiPolyMeshGetSplitView(sample, si, &view);
+        const aiBufferView *views[FillAttributeCount] = {
+            &view.points, &view.velocities, &view.normals, &view.tangents, &view.uv0, &view.uv1, &view.rgba, &view.rgb,
+        };
+        int num_vertices = expected.splits[si].vertex_count;
+        for (int ai = 0; ai < FillAttributeCount; ++ai)
+        {
+            auto& v = *views[ai];
+            const char *src = expected.at(ai, si, format);
+            if (!src || !v.data)
+                continue;
+            int size = FillElementSize((aiVertexAttribute)ai, format);
+            same = same && v.count == num_vertices && v.element_size <= size;
+            for (int vi = 0; same && vi < num_vertices; ++vi)
+                same = memcmp((const char*)v.data + (size_t)vi * v.element_size, src + (size_t)vi * size, v.element_size) == 0;
+        }
+        same = same && memcmp(&view.center, &expected.centers[si], sizeof(abcV3)) == 0 &&
+            memcmp(&view.extents, &expected.extents[si], sizeof(abcV3)) == 0;
+    }
+
+    size_t offset = 0;
+    for (int smi = 0; smi < (int)expected.submeshes.size(); ++smi)
+    {
+        aiBufferView view;
+        aiPolyMeshGetSubmeshView(sample, smi, &view);
+        auto& sm = expected.submeshes[smi];
+        size_t size = (size_t)sm.index_count * sm.index_size;
+        same = same && view.count == sm.index_count && view.element_size == sm.index_size &&
+            memcmp(view.data, expected.indices.data() + offset, size) == 0;
+        offset += size;
+    }
+    return same;
+}
+
+// pins the sample of the first frame and keeps updating with prefetch. the views must stay what was filled for
+// the first frame until the sample is released
+TestCase(ImportAlembic_PinnedViews)
+{
+    const char *path = "PinnedViews.abc";
+    const int num_frames = 10;
+    const float frame_rate = 30.0f;
+    WriteTestMesh(path, num_frames, 5, frame_rate);
+
+    aiConfig config;
+    config.interpolate_samples = false;
+    config.prefetch_count = 2;
+    config.index_format = aiIndexFormat::UInt16IfPossible;
+    aiPolyMesh *mesh;
+    auto ctx = LoadTestMesh(1, path, config, mesh);
+    if (!ctx)
+        return;
+
+    aiContextUpdateSamples(ctx, 0.0);
+    FilledSample first;
+    FillSample(first, mesh, config.vertex_format);
+    auto pinned = aiPolyMeshPinSample(mesh);
+    Print("    pinned: %s\n", pinned && SameViews(pinned, first, config.vertex_format) ? "ok" : "mismatch");
+
+    bool same = true, current_same = true;
+    for (int fi = 1; fi < num_frames; ++fi)
+    {
+        aiContextUpdateSamples(ctx, (double)fi / frame_rate);
+        same = same && SameViews(pinned, first, config.vertex_format);
+
+        // updates continue on another sample, whose views are those of the current frame
+        FilledSample current;
+        FillSample(current, mesh, config.vertex_format);
+        current_same = current_same && SameViews(aiSchemaGetSample(mesh), current, config.vertex_format);
+    }
+    Print("    pinned while updating: %s\n", same ? "ok" : "mismatch");
+    Print("    current while pinned: %s\n", current_same ? "ok" : "mismatch");
+
+    aiPolyMeshReleaseSample(mesh, pinned);
+    aiContextDestroy(ctx);
+}
+
+// uploads only the dirty ranges of each update into a copy of the first fill. the copy must end up the same as a full
+// fill every frame, with aiConfig::dirty_ranges and without
+TestCase(ImportAlembic_DirtyRanges)
+{
+    const char *path = "DirtyRanges.abc";
+    const int num_frames = 10;
+    const float frame_rate = 30.0f;
+    WriteTestMesh(path, num_frames, 5, frame_rate);
+
+    for (int narrow = 0; narrow < 2; ++narrow)
+    {
+        aiConfig config;
+        config.interpolate_samples = false;
+        config.dirty_ranges = narrow != 0;
+        aiPolyMesh *mesh;
+        auto ctx = LoadTestMesh(1, path, config, mesh);
+        if (!ctx)
+            return;
+
+        auto& format = config.vertex_format;
+        FilledSample uploaded;
+        bool same = true;
+        size_t num_dirty = 0, num_total = 0;
+        for (int fi = 0; fi < num_frames; ++fi)
+        {
+            aiContextUpdateSamples(ctx, (double)fi / frame_rate);
+            auto sample = aiSchemaGetSample(mesh);
+            aiMeshSampleSummary summary;
+            aiPolyMeshGetSampleSummary(sample, &summary);
+            std::vector<aiMeshSplitDirtySummary> dirty(summary.split_count);
+            aiPolyMeshGetSplitDirtySummaries(sample, dirty.data());
+
+            FilledSample filled;
+            FillSample(filled, mesh, format);
+            if (fi == 0 || summary.topology_changed)
+            {
+                uploaded = filled;
+                continue;
+            }
+
+            for (int si = 0; si < summary.split_count; ++si)
+            {
+                const aiVertexRange *ranges[FillAttributeCount] = {
+                    &dirty[si].points, &dirty[si].velocities, &dirty[si].normals, &dirty[si].tangents,
+                    &dirty[si].uv0, &dirty[si].uv1, &dirty[si].rgba, &dirty[si].rgb,
+                };
+                for (int ai = 0; ai < FillAttributeCount; ++ai)
+                {
+                    const char *src = filled.at(ai, si, format);
+                    char *dst = uploaded.at(ai, si, format);
+                    auto& r = *ranges[ai];
+                    if (!src || !dst || r.begin >= r.end)
+                        continue;
+                    size_t size = FillElementSize((aiVertexAttribute)ai, format);
+                    memcpy(dst + r.begin * size, src + r.begin * size, (r.end - r.begin) * size);
+                    num_dirty += r.end - r.begin;
+                }
+                num_total += (size_t)filled.splits[si].vertex_count * FillAttributeCount;
+            }
+            same = same && SameFill(uploaded, filled);
+        }
+        Print("    %s: %s (%.1f%% of attribute vertices uploaded after the first frame)\n",
+            narrow ? "dirty_ranges" : "whole splits", same ? "ok" : "mismatch",
+            num_total ? 100.0 * num_dirty / num_total : 0.0);
+        aiContextDestroy(ctx);
+    }
+}
+
+// fills with aiPolyMeshFillVertexBufferAsync() and requests the next frame before waiting for it, and compares with
+// the synchronous fill of a second context. the mesh is large enough to fill on workers
+TestCase(ImportAlembic_AsyncFill)
+{
+    const char *path = "AsyncFill.abc";
+    const int num_frames = 5;
+    const float frame_rate = 30.0f;
+    WriteTestMesh(path, num_frames, 7, frame_rate);
+
+    aiConfig config;
+    config.worker_count = 0;
+    config.interpolate_samples = false;
+    aiPolyMesh *mesh, *sync_mesh;
+    auto ctx = LoadTestMesh(1, path, config, mesh);
+    if (!ctx)
+        return;
+    auto sync_ctx = LoadTestMesh(2, path, config, sync_mesh);
+    if (!sync_ctx)
+    {
+        aiContextDestroy(ctx);
+        return;
+    }
+
+    auto& format = config.vertex_format;
+    aiContextUpdateSamples(ctx, 0.0);
+    for (int fi = 0; fi < num_frames; ++fi)
+    {
+        aiContextUpdateSamples(sync_ctx, (double)fi / frame_rate);
+        FilledSample expected;
+        FillSample(expected, sync_mesh, format);
+
+        // same layout as the synchronous fill, written by the task
+        FilledSample filled = expected;
+        for (auto& a : filled.attributes)
+            std::fill(a.begin(), a.end(), 0);
+        std::fill(filled.indices.begin(), filled.indices.end(), 0);
+        std::vector<aiPolyMeshData> vbs;
+        std::vector<aiSubmeshData> ibs;
+        GetFillBuffers(filled, format, vbs, ibs);
+
+        // without prefetch and cache, the update reads into the sample being filled. it must wait for the fill first
+        auto task = aiPolyMeshFillVertexBufferAsync(aiSchemaGetSample(mesh), vbs.data(), ibs.data());
+        aiContextUpdateSamples(ctx, (double)(fi + 1) / frame_rate);
+        aiAsyncTaskWait(task);
+        Print("    frame %d: %s\n", fi, SameFill(filled, expected) ? "ok" : "mismatch");
+    }
+    aiContextDestroy(sync_ctx);
+    aiContextDestroy(ctx);
+}
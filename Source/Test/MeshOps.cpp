@@ -0,0 +1,479 @@
+#include "pch.h"
+// mesh operations are called directly, with the same attribute types abci builds them with
+#include "../abci/pch.h"
+#include "../abci/Foundation/aiMeshOps.h"
+#include "MeshGenerator.h"
+#include "Test.h"
+
+
+struct RefineInput
+{
+    std::vector<int> counts, indices;
+    std::vector<float3> points;
+    RawVector<abcV3> normals; // per point
+    RawVector<abcV2> uv; // per index. some faces are offset to make seams
+    RawVector<abcC4> colors; // per index. one color per group of faces
+};
+
+// icosphere. mixed: some triangles become point and line faces and some pairs become quads
+static void GenerateRefineInput(RefineInput& dst, int iteration, bool mixed)
+{
+    std::vector<int> counts, indices;
+    std::vector<float2> uv;
+    GenerateIcoSphereMesh(counts, indices, dst.points, uv, 0.5f, iteration);
+
+    dst.counts.clear();
+    dst.indices.clear();
+    int num_triangles = (int)counts.size();
+    for (int ti = 0; ti < num_triangles; ++ti)
+    {
+        const int *tri = &indices[ti * 3];
+        if (mixed && ti % 16 == 0)
+        {
+            dst.counts.push_back(1);
+            dst.indices.push_back(tri[0]);
+            dst.counts.push_back(2);
+            dst.indices.insert(dst.indices.end(), { tri[1], tri[2] });
+        }
+        else if (mixed && ti % 16 == 1 && ti + 1 < num_triangles)
+        {
+            dst.counts.push_back(4);
+            dst.indices.insert(dst.indices.end(), { tri[0], tri[1], tri[2], indices[ti * 3 + 5] });
+            ++ti;
+        }
+        else
+        {
+            dst.counts.push_back(3);
+            dst.indices.insert(dst.indices.end(), { tri[0], tri[1], tri[2] });
+        }
+    }
+
+    int num_points = (int)dst.points.size();
+    dst.normals.resize_discard(num_points);
+    for (int pi = 0; pi < num_points; ++pi)
+    {
+        auto n = normalize(dst.points[pi]);
+        dst.normals[pi] = { n.x, n.y, n.z };
+    }
+
+    int num_indices = (int)dst.indices.size();
+    dst.uv.resize_discard(num_indices);
+    dst.colors.resize_discard(num_indices);
+    int num_faces = (int)dst.counts.size();
+    for (int fi = 0, ii = 0; fi < num_faces; ++fi)
+    {
+        float offset = fi % 5 == 0 ? 0.5f : 0.0f;
+        abcC4 color{ (float)(fi / 64 % 3), (float)(fi / 64 % 7), 0.0f, 1.0f };
+        for (int ci = 0; ci < dst.counts[fi]; ++ci, ++ii)
+        {
+            auto& p = dst.points[dst.indices[ii]];
+            dst.uv[ii] = { std::atan2(p.z, p.x) + offset, p.y };
+            dst.colors[ii] = color;
+        }
+    }
+}
+
+struct RefineOutput
+{
+    MeshRefiner refiner;
+    RawVector<abcV3> normals;
+    RawVector<abcV2> uv;
+    RawVector<abcC4> colors;
+    RawVector<int> normals_src, uv_src, colors_src;
+};
+
+// num_attributes: normals, uv and colors are added in this order
+static void Refine(RefineOutput& dst, const RefineInput& src, int num_workers, int split_unit,
+    int num_attributes = 3, bool fuse_attributes = true, bool index16 = false)
+{
+    auto& refiner = dst.refiner;
+    refiner.split_unit = split_unit;
+    refiner.worker_count = num_workers;
+    refiner.fuse_attributes = fuse_attributes;
+    refiner.index16 = index16;
+    refiner.counts = src.counts;
+    refiner.indices = src.indices;
+    refiner.points = src.points;
+    if (num_attributes > 0)
+        refiner.addIndexedAttribute<abcV3>(src.normals, refiner.indices, dst.normals, dst.normals_src);
+    if (num_attributes > 1)
+        refiner.addExpandedAttribute<abcV2>(src.uv, dst.uv, dst.uv_src);
+    if (num_attributes > 2)
+        refiner.addExpandedAttribute<abcC4>(src.colors, dst.colors, dst.colors_src);
+    refiner.refine();
+    refiner.retopology(false);
+    refiner.genSubmeshes();
+}
+
+template<class T>
+static bool SameArray(const char *name, const RawVector<T>& a, const RawVector<T>& b)
+{
+    if (a == b)
+        return true;
+    Print("      %s differ\n", name);
+    return false;
+}
+
+static bool SameSubmeshes(const RawVector<MeshRefiner::Submesh>& a, const RawVector<MeshRefiner::Submesh>& b)
+{
+    // dst_indices points into the refiner that made them
+    bool ret = a.size() == b.size();
+    for (size_t i = 0; ret && i < a.size(); ++i)
+    {
+        ret = a[i].topology == b[i].topology && a[i].split_index == b[i].split_index &&
+            a[i].submesh_index == b[i].submesh_index && a[i].index_count == b[i].index_count &&
+            a[i].index_offset == b[i].index_offset && a[i].index_size == b[i].index_size;
+    }
+    if (!ret)
+        Print("      submeshes differ\n");
+    return ret;
+}
+
+// indices of a submesh, from whichever buffer MeshRefiner::index16 put them in
+static void GetSubmeshIndices(RawVector<int>& dst, const MeshRefiner& refiner, const MeshRefiner::Submesh& sm)
+{
+    dst.resize_discard(sm.index_count);
+    for (int ii = 0; ii < sm.index_count; ++ii)
+    {
+        dst[ii] = sm.index_size == 2 ?
+            (int)refiner.new_indices_submeshes16[sm.index_offset + ii] : refiner.new_indices_submeshes[sm.index_offset + ii];
+    }
+}
+
+static bool SameRefinement(const RefineOutput& a, const RefineOutput& b)
+{
+    auto& ra = a.refiner;
+    auto& rb = b.refiner;
+    // no short circuit, to report every output that differs
+    bool ret = true;
+    ret &= SameArray("new_points", ra.new_points, rb.new_points);
+    ret &= SameArray("new2old_points", ra.new2old_points, rb.new2old_points);
+    ret &= SameArray("new_indices", ra.new_indices, rb.new_indices);
+    ret &= SameArray("new_indices_tri", ra.new_indices_tri, rb.new_indices_tri);
+    ret &= SameArray("new_indices_lines", ra.new_indices_lines, rb.new_indices_lines);
+    ret &= SameArray("new_indices_points", ra.new_indices_points, rb.new_indices_points);
+    ret &= SameArray("new_indices_submeshes", ra.new_indices_submeshes, rb.new_indices_submeshes);
+    ret &= SameArray("splits", ra.splits, rb.splits);
+    ret &= SameSubmeshes(ra.submeshes, rb.submeshes);
+    ret &= SameArray("normals", a.normals, b.normals);
+    ret &= SameArray("normals_src", a.normals_src, b.normals_src);
+    ret &= SameArray("uv", a.uv, b.uv);
+    ret &= SameArray("uv_src", a.uv_src, b.uv_src);
+    ret &= SameArray("colors", a.colors, b.colors);
+    ret &= SameArray("colors_src", a.colors_src, b.colors_src);
+    return ret;
+}
+
+
+// refines the same meshes serially and on workers. MeshRefiner::worker_count must not change the results.
+TestCase(MeshOps_RefineWorkerCount)
+{
+    RefineInput sphere, mixed;
+    GenerateRefineInput(sphere, 6, false);
+    GenerateRefineInput(mixed, 6, true);
+    int num_points = (int)sphere.points.size();
+
+    struct Case
+    {
+        const char *name;
+        const RefineInput *input;
+        int split_unit;
+    };
+    Case cases[] = {
+        { "large mesh", &sphere, 0 },
+        // seams make more vertices than points. the parallel path finds they don't fit and falls back to serial
+        { "split_unit fallback", &sphere, num_points },
+        { "multiple splits", &sphere, num_points / 4 },
+        { "mixed faces", &mixed, 0 },
+    };
+    int worker_counts[] = { 2, 4, 0 };
+
+    for (auto& c : cases)
+    {
+        std::unique_ptr<RefineOutput> serial(new RefineOutput());
+        Refine(*serial, *c.input, 1, c.split_unit);
+        for (int num_workers : worker_counts)
+        {
+            std::unique_ptr<RefineOutput> parallel(new RefineOutput());
+            Refine(*parallel, *c.input, num_workers, c.split_unit);
+            bool same = SameRefinement(*serial, *parallel);
+            Print("    %s, %d worker(s): %s (%d splits, %d vertices)\n", c.name, num_workers, same ? "ok" : "mismatch",
+                (int)parallel->refiner.splits.size(), (int)parallel->refiner.new_points.size());
+        }
+    }
+}
+
+// refines every attribute set that has a fused loop through it and through IAttribute. the results must be the same.
+TestCase(MeshOps_RefineFused)
+{
+    RefineInput mixed;
+    GenerateRefineInput(mixed, 6, true);
+
+    const char *attribute_sets[] = { "P", "P+N", "P+N+UV0", "P+N+UV0+C" };
+    int worker_counts[] = { 1, 0 };
+    for (int num_attributes = 0; num_attributes < 4; ++num_attributes)
+    {
+        for (int num_workers : worker_counts)
+        {
+            std::unique_ptr<RefineOutput> fused(new RefineOutput());
+            std::unique_ptr<RefineOutput> dynamic(new RefineOutput());
+            Refine(*fused, mixed, num_workers, 0, num_attributes, true);
+            Refine(*dynamic, mixed, num_workers, 0, num_attributes, false);
+            bool same = SameRefinement(*fused, *dynamic);
+            Print("    %s, %s: %s\n", attribute_sets[num_attributes], num_workers == 1 ? "serial" : "all workers",
+                same ? "ok" : "mismatch");
+        }
+    }
+}
+
+// computes point normals of a refined mesh with point, line and polygon faces on any number of workers.
+// the results must be the same as on one.
+TestCase(MeshOps_PointNormalsWorkerCount)
+{
+    RefineInput mixed;
+    GenerateRefineInput(mixed, 7, true);
+    std::unique_ptr<RefineOutput> refined(new RefineOutput());
+    Refine(*refined, mixed, 1, 0);
+
+    auto& refiner = refined->refiner;
+    if (refiner.connection.v2f_counts.size() != refiner.points.size())
+        refiner.connection.buildConnection(refiner.indices, refiner.counts, refiner.points);
+
+    auto generate = [&](RawVector<float3>& dst, int num_workers) {
+        dst.resize_discard(refiner.new_points.size());
+        GeneratePointNormals(refiner.connection, refiner.counts, refiner.indices, refiner.points,
+            refiner.new2old_points, dst.data(), num_workers);
+    };
+
+    RawVector<float3> serial;
+    generate(serial, 1);
+    int worker_counts[] = { 2, 4, 0 };
+    for (int num_workers : worker_counts)
+    {
+        RawVector<float3> parallel;
+        generate(parallel, num_workers);
+        Print("    %d worker(s): %s (%d vertices)\n", num_workers, serial == parallel ? "ok" : "mismatch",
+            (int)parallel.size());
+    }
+}
+
+// refines with 16 bit submesh indices and without. submeshes of splits that fit in 0xffff vertices must be narrowed,
+// the others must stay 32 bit, and both must hold the same indices as the 32 bit output.
+TestCase(MeshOps_Index16)
+{
+    RefineInput sphere;
+    GenerateRefineInput(sphere, 6, true);
+
+    struct Case
+    {
+        const char *name;
+        int split_unit;
+    };
+    Case cases[] = {
+        { "one large split", 0 },
+        { "splits of up to 0xffff vertices", 0xffff },
+        { "large and small splits", 100000 },
+    };
+
+    for (auto& c : cases)
+    {
+        std::unique_ptr<RefineOutput> wide(new RefineOutput());
+        std::unique_ptr<RefineOutput> narrow(new RefineOutput());
+        Refine(*wide, sphere, 0, c.split_unit, 3, true, false);
+        Refine(*narrow, sphere, 0, c.split_unit, 3, true, true);
+
+        auto& rw = wide->refiner;
+        auto& rn = narrow->refiner;
+        bool same = rw.submeshes.size() == rn.submeshes.size();
+        int num_narrow = 0;
+        RawVector<int> iw, in;
+        for (size_t si = 0; same && si < rn.submeshes.size(); ++si)
+        {
+            auto& smw = rw.submeshes[si];
+            auto& smn = rn.submeshes[si];
+            bool fits = rn.splits[smn.split_index].vertex_count <= 0xffff;
+            GetSubmeshIndices(iw, rw, smw);
+            GetSubmeshIndices(in, rn, smn);
+            same = smw.index_size == 4 && smn.index_size == (fits ? 2 : 4) && iw == in;
+            if (smn.index_size == 2)
+                ++num_narrow;
+        }
+        same = same && SameArray("new_points", rw.new_points, rn.new_points) && SameArray("splits", rw.splits, rn.splits);
+        Print("    %s: %s (%d splits, %d of %d submeshes narrowed)\n", c.name, same ? "ok" : "mismatch",
+            (int)rn.splits.size(), num_narrow, (int)rn.submeshes.size());
+    }
+}
+
+static abcV3 DecodeOctahedral(int16_t x, int16_t y)
+{
+    float ox = std::max((float)x / 32767.0f, -1.0f);
+    float oy = std::max((float)y / 32767.0f, -1.0f);
+    float z = 1.0f - std::abs(ox) - std::abs(oy);
+    if (z < 0.0f)
+    {
+        float tx = (1.0f - std::abs(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+        float ty = (1.0f - std::abs(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+        ox = tx;
+        oy = ty;
+    }
+    float l = std::sqrt(ox * ox + oy * oy + z * z);
+    return { ox / l, oy / l, z / l };
+}
+
+static float DecodeHalf(uint16_t h)
+{
+    int exponent = (h >> 10) & 0x1f;
+    float mantissa = (float)(h & 0x3ff);
+    float v = exponent == 0 ? mantissa * std::ldexp(1.0f, -24) : (mantissa + 1024.0f) * std::ldexp(1.0f, exponent - 25);
+    return (h & 0x8000) ? -v : v;
+}
+
+// encodes the attributes of a refined mesh to each aiAttributeFormat and decodes them again.
+// errors must stay within what the encodings can represent.
+TestCase(MeshOps_Encode)
+{
+    RefineInput sphere;
+    GenerateRefineInput(sphere, 6, true);
+    std::unique_ptr<RefineOutput> refined(new RefineOutput());
+    Refine(*refined, sphere, 0, 0);
+    auto& normals = refined->normals;
+    auto& uv = refined->uv;
+    auto& colors = refined->colors;
+    int num = (int)normals.size();
+
+    // octahedral snorm16: one step is 1/32767 on a face of the octahedron, which is at most ~1e-4 on the sphere
+    {
+        RawVector<snorm16x2> q;
+        q.resize_discard(num);
+        Encode(q.data(), normals.data(), num);
+        float max_error = 0.0f;
+        for (int i = 0; i < num; ++i)
+        {
+            auto d = DecodeOctahedral(q[i].x, q[i].y);
+            auto& n = normals[i];
+            max_error = std::max({ max_error, std::abs(d.x - n.x), std::abs(d.y - n.y), std::abs(d.z - n.z) });
+        }
+        Print("    normals: %s (max error %g)\n", max_error < 2e-4f ? "ok" : "mismatch", max_error);
+    }
+
+    // tangents take the octahedral normal path for xyz. w is only its sign
+    {
+        RawVector<abcV4> tangents;
+        tangents.resize_discard(num);
+        for (int i = 0; i < num; ++i)
+            tangents[i] = { normals[i].y, -normals[i].x, normals[i].z, i % 3 == 0 ? -1.0f : 1.0f };
+        RawVector<snorm16x4> q;
+        q.resize_discard(num);
+        Encode(q.data(), tangents.data(), num);
+        float max_error = 0.0f;
+        bool same_w = true;
+        for (int i = 0; i < num; ++i)
+        {
+            auto d = DecodeOctahedral(q[i].x, q[i].y);
+            auto& t = tangents[i];
+            max_error = std::max({ max_error, std::abs(d.x - t.x), std::abs(d.y - t.y), std::abs(d.z - t.z) });
+            same_w = same_w && q[i].z == (t.w < 0.0f ? -32767 : 32767) && q[i].w == 0;
+        }
+        Print("    tangents: %s (max error %g)\n", max_error < 2e-4f && same_w ? "ok" : "mismatch", max_error);
+    }
+
+    // half: 11 significant bits, so the error is at most 2^-11 relative to the value
+    {
+        RawVector<half16x2> q;
+        q.resize_discard(num);
+        Encode(q.data(), uv.data(), num);
+        float max_error = 0.0f;
+        bool within = true;
+        for (int i = 0; i < num; ++i)
+        {
+            float ex = std::abs(DecodeHalf(q[i].x) - uv[i].x);
+            float ey = std::abs(DecodeHalf(q[i].y) - uv[i].y);
+            within = within && ex <= std::abs(uv[i].x) / 2048.0f + 1e-7f && ey <= std::abs(uv[i].y) / 2048.0f + 1e-7f;
+            max_error = std::max({ max_error, ex, ey });
+        }
+        Print("    uv: %s (max error %g)\n", within ? "ok" : "mismatch", max_error);
+    }
+
+    // unorm8: rounded to the nearest of 255 steps. rgb colors get an alpha of 255
+    {
+        RawVector<abcC3> rgb;
+        rgb.resize_discard(num);
+        for (int i = 0; i < num; ++i)
+            rgb[i] = { colors[i].r * 0.3f, colors[i].g * 0.1f, 0.75f };
+        RawVector<unorm8x4> q4, q3;
+        q4.resize_discard(num);
+        q3.resize_discard(num);
+        Encode(q4.data(), colors.data(), num);
+        Encode(q3.data(), rgb.data(), num);
+        float max_error = 0.0f;
+        bool alpha = true;
+        for (int i = 0; i < num; ++i)
+        {
+            auto c = colors[i];
+            c.r = std::min(std::max(c.r, 0.0f), 1.0f);
+            c.g = std::min(std::max(c.g, 0.0f), 1.0f);
+            auto& r = rgb[i];
+            max_error = std::max({ max_error,
+                std::abs(q4[i].x / 255.0f - c.r), std::abs(q4[i].y / 255.0f - c.g), std::abs(q4[i].z / 255.0f - c.b),
+                std::abs(q4[i].w / 255.0f - c.a), std::abs(q3[i].x / 255.0f - std::min(r.x, 1.0f)),
+                std::abs(q3[i].y / 255.0f - std::min(r.y, 1.0f)), std::abs(q3[i].z / 255.0f - r.z) });
+            alpha = alpha && q3[i].w == 255;
+        }
+        Print("    colors: %s (max error %g)\n", max_error <= 0.5f / 255.0f + 1e-6f && alpha ? "ok" : "mismatch", max_error);
+    }
+}
+
+// times GenerateTangents() on a refined high poly mesh: the single pass overload against the partitioned one on
+// varying worker counts. the partitioned results must be the same for any worker count. they differ from the single
+// pass in the last bits, because partition sums are added in another order
+TestCase(MeshOps_Tangents)
+{
+    RefineInput sphere;
+    GenerateRefineInput(sphere, 8, false);
+    std::unique_ptr<RefineOutput> refined(new RefineOutput());
+    Refine(*refined, sphere, 0, 0, 2);
+
+    auto& refiner = refined->refiner;
+    auto& indices = refiner.new_indices_tri;
+    int num_points = (int)refiner.new_points.size();
+    int num_triangles = (int)indices.size() / 3;
+    RawVector<abcV3> points;
+    points.resize_discard(num_points);
+    for (int pi = 0; pi < num_points; ++pi)
+        points[pi] = { refiner.new_points[pi].x, refiner.new_points[pi].y, refiner.new_points[pi].z };
+    auto& normals = refined->normals;
+    auto& uv = refined->uv;
+    Print("    %d triangles, %d vertices\n", num_triangles, num_points);
+
+    RawVector<abcV4> serial;
+    serial.resize_discard(num_points);
+    TestScope("single pass", [&]() {
+        GenerateTangents(serial.data(), points.data(), uv.data(), normals.data(), indices.data(),
+            num_points, num_triangles);
+    }, 5);
+
+    RawVector<abcV4> first;
+    int worker_counts[] = { 1, 2, 4, 0 };
+    for (int num_workers : worker_counts)
+    {
+        RawVector<abcV4> tangents;
+        tangents.resize_discard(num_points);
+        char name[64];
+        sprintf(name, "%d worker(s)", num_workers);
+        TestScope(name, [&]() {
+            GenerateTangents(tangents.data(), points.data(), uv.data(), normals.data(), indices.data(),
+                num_points, num_triangles, num_workers);
+        }, 5);
+
+        float max_diff = 0.0f;
+        for (int pi = 0; pi < num_points; ++pi)
+        {
+            auto& a = tangents[pi];
+            auto& b = serial[pi];
+            max_diff = std::max({ max_diff, std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z), std::abs(a.w - b.w) });
+        }
+        if (first.empty())
+            first = tangents;
+        Print("      %s, max difference from single pass: %g\n", tangents == first ? "ok" : "mismatch", max_diff);
+    }
+}
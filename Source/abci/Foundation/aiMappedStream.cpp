@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "aiMappedStream.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// reads at least this large prefetch their pages in one go instead of faulting them in one by one
+static const size_t kWillNeedThreshold = 256 * 1024;
+
+std::shared_ptr<aiMappedFile> aiMappedFile::open(const char *path)
+{
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        addr = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return nullptr;
+
+    std::shared_ptr<aiMappedFile> ret(new aiMappedFile((const char*)addr, (size_t)st.st_size));
+    // Ogawa jumps between object headers and sample data, so readahead mostly fetches pages nobody reads
+    ret->advise(0, ret->size(), aiAccessHint::Random);
+    return ret;
+}
+
+aiMappedFile::aiMappedFile(const char *data, size_t size)
+    : m_data(data), m_size(size)
+{
+}
+
+aiMappedFile::~aiMappedFile()
+{
+    if (m_data)
+        ::munmap((void*)m_data, m_size);
+}
+
+void aiMappedFile::advise(size_t offset, size_t size, aiAccessHint hint) const
+{
+    if (offset >= m_size)
+        return;
+    size = std::min(size, m_size - offset);
+
+    // madvise() wants a page aligned address
+    static const size_t page_size = (size_t)::sysconf(_SC_PAGESIZE);
+    size_t begin = offset / page_size * page_size;
+    size_t end = offset + size;
+
+    int advice = MADV_NORMAL;
+    switch (hint)
+    {
+    case aiAccessHint::Sequential: advice = MADV_SEQUENTIAL; break;
+    case aiAccessHint::Random: advice = MADV_RANDOM; break;
+    case aiAccessHint::WillNeed: advice = MADV_WILLNEED; break;
+    default: break;
+    }
+    ::madvise((void*)(m_data + begin), end - begin, advice);
+}
+
+
+aiMappedStreamBuf::aiMappedStreamBuf(std::shared_ptr<aiMappedFile> file)
+    : m_file(std::move(file))
+{
+    auto *begin = const_cast<char*>(m_file->data());
+    setg(begin, begin, begin + m_file->size());
+}
+
+std::streamsize aiMappedStreamBuf::xsgetn(char_type *dst, std::streamsize n)
+{
+    n = std::min(n, (std::streamsize)(egptr() - gptr()));
+    if (n <= 0)
+        return 0;
+
+    // array samples are read in one piece. WILLNEED doesn't split the mapping like per range SEQUENTIAL would
+    if ((size_t)n >= kWillNeedThreshold)
+        m_file->advise(gptr() - eback(), (size_t)n, aiAccessHint::WillNeed);
+    memcpy(dst, gptr(), (size_t)n);
+    // gbump() takes int. arrays can exceed 2GB
+    setg(eback(), gptr() + n, egptr());
+    return n;
+}
+
+std::streamsize aiMappedStreamBuf::showmanyc()
+{
+    auto n = egptr() - gptr();
+    return n > 0 ? n : -1;
+}
+
+aiMappedStreamBuf::pos_type aiMappedStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in))
+        return pos_type(off_type(-1));
+
+    off_type base = 0;
+    if (dir == std::ios_base::cur)
+        base = gptr() - eback();
+    else if (dir == std::ios_base::end)
+        base = egptr() - eback();
+
+    off_type pos = base + off;
+    if (pos < 0 || pos > egptr() - eback())
+        return pos_type(off_type(-1));
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+}
+
+aiMappedStreamBuf::pos_type aiMappedStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+aiMappedIStream::aiMappedIStream(std::shared_ptr<aiMappedFile> file)
+    : std::istream(nullptr), m_buf(std::move(file))
+{
+    rdbuf(&m_buf);
+}
+
+#endif // __linux__
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifdef __linux__
+
+enum class aiAccessHint
+{
+    Normal,
+    Sequential,
+    Random,
+    WillNeed, // start reading the pages in now
+};
+
+// read-only memory mapping of a whole file. shared by all streams that read the same archive.
+// the mapping is MAP_SHARED, so if another process truncates or rewrites the file while it is mapped, reading the
+// pages past the new end raises SIGBUS instead of a stream error. only use it for files that stay unchanged while
+// loaded (aiConfig::map_archives, off by default).
+class aiMappedFile
+{
+public:
+    static std::shared_ptr<aiMappedFile> open(const char *path);
+    ~aiMappedFile();
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    // madvise() for the pages that cover [offset, offset + size)
+    void advise(size_t offset, size_t size, aiAccessHint hint) const;
+
+private:
+    aiMappedFile(const char *data, size_t size);
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// streambuf that serves reads straight from a mapped file.
+// the whole file is the get area, so read() is one memcpy from the page cache and seeks never touch the file.
+class aiMappedStreamBuf : public std::streambuf
+{
+public:
+    explicit aiMappedStreamBuf(std::shared_ptr<aiMappedFile> file);
+
+protected:
+    std::streamsize xsgetn(char_type *dst, std::streamsize n) override;
+    std::streamsize showmanyc() override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+private:
+    std::shared_ptr<aiMappedFile> m_file;
+};
+
+class aiMappedIStream : public std::istream
+{
+public:
+    explicit aiMappedIStream(std::shared_ptr<aiMappedFile> file);
+
+private:
+    aiMappedStreamBuf m_buf;
+};
+
+#endif // __linux__
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "aiMath.h"
 #include "RawVector.h"
+#include "aiThreadPool.h"
 #include <numeric>
 
 // ispc implementation
@@ -38,6 +39,85 @@ void GenerateVelocitiesISPC(abcV3 *dst, const abcV3 *p1, const abcV3 *p2, int nu
         (ispc::float3*)dst, (ispc::float3*)p1, (ispc::float3*)p2, num, motion_scale);
 }
 
+template<class T>
+static inline void RemapTransformISPCImpl(T *dst, const T *src, const int *indices, int num, const T& mul)
+{
+    const int stride = sizeof(T) / sizeof(float);
+    ispc::RemapTransform((float*)dst, (const float*)src, indices, num, stride, (const float*)&mul);
+}
+
+template<class T>
+static inline void RemapTransformISPCImpl(T *dst1, T *dst2, const T *src1, const T *src2, const int *indices, int num, const T& mul)
+{
+    const int stride = sizeof(T) / sizeof(float);
+    ispc::RemapTransform2((float*)dst1, (float*)dst2, (const float*)src1, (const float*)src2, indices, num, stride, (const float*)&mul);
+}
+
+void RemapTransformISPC(abcV2 *dst, const abcV2 *src, const int *indices, int num, const abcV2& mul)
+{
+    RemapTransformISPCImpl(dst, src, indices, num, mul);
+}
+
+void RemapTransformISPC(abcV3 *dst, const abcV3 *src, const int *indices, int num, const abcV3& mul)
+{
+    RemapTransformISPCImpl(dst, src, indices, num, mul);
+}
+
+void RemapTransformISPC(abcC4 *dst, const abcC4 *src, const int *indices, int num, const abcC4& mul)
+{
+    RemapTransformISPCImpl(dst, src, indices, num, mul);
+}
+
+void RemapTransformISPC(abcV2 *dst1, abcV2 *dst2, const abcV2 *src1, const abcV2 *src2, const int *indices, int num, const abcV2& mul)
+{
+    RemapTransformISPCImpl(dst1, dst2, src1, src2, indices, num, mul);
+}
+
+void RemapTransformISPC(abcV3 *dst1, abcV3 *dst2, const abcV3 *src1, const abcV3 *src2, const int *indices, int num, const abcV3& mul)
+{
+    RemapTransformISPCImpl(dst1, dst2, src1, src2, indices, num, mul);
+}
+
+void RemapTransformISPC(abcC4 *dst1, abcC4 *dst2, const abcC4 *src1, const abcC4 *src2, const int *indices, int num, const abcC4& mul)
+{
+    RemapTransformISPCImpl(dst1, dst2, src1, src2, indices, num, mul);
+}
+
+void ExpandISPC(abcV4 *dst, const abcV3 *src, int num, float w)
+{
+    ispc::Expand3To4((float*)dst, (const float*)src, num, w);
+}
+
+void ExpandISPC(abcC4 *dst, const abcC3 *src, int num, float w)
+{
+    ispc::Expand3To4((float*)dst, (const float*)src, num, w);
+}
+
+void EncodeISPC(snorm16x2 *dst, const abcV3 *src, int num)
+{
+    ispc::EncodeOctahedral((int16_t*)dst, (const float*)src, num, 3, 2);
+}
+
+void EncodeISPC(snorm16x4 *dst, const abcV4 *src, int num)
+{
+    ispc::EncodeOctahedral((int16_t*)dst, (const float*)src, num, 4, 4);
+}
+
+void EncodeISPC(half16x2 *dst, const abcV2 *src, int num)
+{
+    ispc::FloatToHalf((uint16_t*)dst, (const float*)src, num * 2);
+}
+
+void EncodeISPC(unorm8x4 *dst, const abcC4 *src, int num)
+{
+    ispc::FloatToUNorm8((uint8_t*)dst, (const float*)src, num, 4);
+}
+
+void EncodeISPC(unorm8x4 *dst, const abcC3 *src, int num)
+{
+    ispc::FloatToUNorm8((uint8_t*)dst, (const float*)src, num, 3);
+}
+
 void MinMaxISPC(abcV3 & min, abcV3 & max, const abcV3 * points, int num)
 {
     ispc::MinMax3((ispc::float3&)min, (ispc::float3&)max, (const ispc::float3*)points, num);
@@ -52,14 +132,6 @@ void GenerateTangentsISPC(abcV4 *dst,
         (ispc::float4*)dst, (const ispc::float3*)points, (const ispc::float2*)uv, (const ispc::float3*)normals, indices, num_points, num_triangles);
 }
 
-void GeneratePointNormalsISPC(const int *face_start_offsets, const int *face_vertex_counts, const int *face_indices,
-    const float *positions, float *normals, const int *remapped_indices, const int face_count, const int remapped_count, const int orig_point_count)
-{
-    std::vector<float> temp_normals(orig_point_count * 3, 0);
-    memset(normals, 0, remapped_count * 3 * sizeof(float));
-    ispc::GeneratePointNormals(face_start_offsets, face_vertex_counts, face_indices, positions, normals, remapped_indices, face_count, remapped_count, orig_point_count);
-}
-
 #endif // aiEnableISPC
 
 
@@ -100,6 +172,188 @@ void LerpGeneric(abcC4 *dst, const abcC4 *v1, const abcC4 *v2, int num, float w)
     }
 }
 
+template<class T4, class T3>
+static inline void ExpandGenericImpl(T4 *dst_, const T3 *src_, int num, float w)
+{
+    auto *dst = (float*)dst_;
+    auto *src = (const float*)src_;
+    for (int i = 0; i < num; ++i)
+    {
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = w;
+    }
+}
+
+void ExpandGeneric(abcV4 *dst, const abcV3 *src, int num, float w)
+{
+    ExpandGenericImpl(dst, src, num, w);
+}
+
+void ExpandGeneric(abcC4 *dst, const abcC3 *src, int num, float w)
+{
+    ExpandGenericImpl(dst, src, num, w);
+}
+
+static inline int16_t to_snorm16(float v)
+{
+    return (int16_t)std::round(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f);
+}
+
+static inline uint8_t to_unorm8(float v)
+{
+    return (uint8_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static inline uint16_t to_half(float v)
+{
+    uint32_t x;
+    memcpy(&x, &v, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mantissa = x & 0x7fffff;
+    int exponent = (int)((x >> 23) & 0xff);
+    if (exponent == 0xff)
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0)); // inf or nan
+    exponent = exponent - 127 + 15;
+    if (exponent >= 0x1f)
+        return (uint16_t)(sign | 0x7c00); // overflow
+    if (exponent <= 0)
+    {
+        // denormal or zero
+        if (exponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t h = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            ++h;
+        return (uint16_t)(sign | h);
+    }
+    // rounding may carry into the exponent, which is still correct
+    uint32_t h = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        ++h;
+    return (uint16_t)h;
+}
+
+// octahedral projection of a unit vector onto [-1, 1]^2
+static inline void oct_encode(float x, float y, float z, int16_t *dst)
+{
+    float s = std::abs(x) + std::abs(y) + std::abs(z);
+    float rs = s > 0.0f ? 1.0f / s : 0.0f;
+    float ox = x * rs, oy = y * rs;
+    if (z < 0.0f)
+    {
+        float tx = (1.0f - std::abs(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+        float ty = (1.0f - std::abs(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+        ox = tx;
+        oy = ty;
+    }
+    dst[0] = to_snorm16(ox);
+    dst[1] = to_snorm16(oy);
+}
+
+void EncodeGeneric(snorm16x2 *dst, const abcV3 *src, int num)
+{
+    for (int i = 0; i < num; ++i)
+        oct_encode(src[i].x, src[i].y, src[i].z, &dst[i].x);
+}
+
+void EncodeGeneric(snorm16x4 *dst, const abcV4 *src, int num)
+{
+    for (int i = 0; i < num; ++i)
+    {
+        oct_encode(src[i].x, src[i].y, src[i].z, &dst[i].x);
+        dst[i].z = src[i].w < 0.0f ? -32767 : 32767;
+        dst[i].w = 0;
+    }
+}
+
+void EncodeGeneric(half16x2 *dst, const abcV2 *src, int num)
+{
+    for (int i = 0; i < num; ++i)
+        dst[i] = { to_half(src[i].x), to_half(src[i].y) };
+}
+
+void EncodeGeneric(unorm8x4 *dst, const abcC4 *src, int num)
+{
+    for (int i = 0; i < num; ++i)
+        dst[i] = { to_unorm8(src[i].r), to_unorm8(src[i].g), to_unorm8(src[i].b), to_unorm8(src[i].a) };
+}
+
+void EncodeGeneric(unorm8x4 *dst, const abcC3 *src, int num)
+{
+    for (int i = 0; i < num; ++i)
+        dst[i] = { to_unorm8(src[i].x), to_unorm8(src[i].y), to_unorm8(src[i].z), 255 };
+}
+
+// operates on floats so that the inner loop has a fixed trip count and vectorizes
+template<class T>
+static inline void RemapTransformGenericImpl(T *dst_, const T *src_, const int *indices, int num, const T& mul_)
+{
+    const int stride = sizeof(T) / sizeof(float);
+    auto *dst = (float*)dst_;
+    auto *src = (const float*)src_;
+    auto *mul = (const float*)&mul_;
+    for (int i = 0; i < num; ++i)
+    {
+        int si = indices ? indices[i] : i;
+        for (int c = 0; c < stride; ++c)
+            dst[i * stride + c] = src[si * stride + c] * mul[c];
+    }
+}
+
+template<class T>
+static inline void RemapTransformGenericImpl(T *dst1_, T *dst2_, const T *src1_, const T *src2_, const int *indices, int num, const T& mul_)
+{
+    const int stride = sizeof(T) / sizeof(float);
+    auto *dst1 = (float*)dst1_;
+    auto *dst2 = (float*)dst2_;
+    auto *src1 = (const float*)src1_;
+    auto *src2 = (const float*)src2_;
+    auto *mul = (const float*)&mul_;
+    for (int i = 0; i < num; ++i)
+    {
+        int si = indices ? indices[i] : i;
+        for (int c = 0; c < stride; ++c)
+        {
+            dst1[i * stride + c] = src1[si * stride + c] * mul[c];
+            dst2[i * stride + c] = src2[si * stride + c] * mul[c];
+        }
+    }
+}
+
+void RemapTransformGeneric(abcV2 *dst, const abcV2 *src, const int *indices, int num, const abcV2& mul)
+{
+    RemapTransformGenericImpl(dst, src, indices, num, mul);
+}
+
+void RemapTransformGeneric(abcV3 *dst, const abcV3 *src, const int *indices, int num, const abcV3& mul)
+{
+    RemapTransformGenericImpl(dst, src, indices, num, mul);
+}
+
+void RemapTransformGeneric(abcC4 *dst, const abcC4 *src, const int *indices, int num, const abcC4& mul)
+{
+    RemapTransformGenericImpl(dst, src, indices, num, mul);
+}
+
+void RemapTransformGeneric(abcV2 *dst1, abcV2 *dst2, const abcV2 *src1, const abcV2 *src2, const int *indices, int num, const abcV2& mul)
+{
+    RemapTransformGenericImpl(dst1, dst2, src1, src2, indices, num, mul);
+}
+
+void RemapTransformGeneric(abcV3 *dst1, abcV3 *dst2, const abcV3 *src1, const abcV3 *src2, const int *indices, int num, const abcV3& mul)
+{
+    RemapTransformGenericImpl(dst1, dst2, src1, src2, indices, num, mul);
+}
+
+void RemapTransformGeneric(abcC4 *dst1, abcC4 *dst2, const abcC4 *src1, const abcC4 *src2, const int *indices, int num, const abcC4& mul)
+{
+    RemapTransformGenericImpl(dst1, dst2, src1, src2, indices, num, mul);
+}
+
 void NormalizeGeneric(abcV3 *dst_, int num)
 {
     auto *dst = (float3*)dst_;
@@ -171,38 +425,6 @@ void GenerateTangentsGeneric(abcV4 *dst_,
 }
 
 
-void GeneratePointNormalsGeneric(const int *face_start_offsets, const int *face_vertex_counts, const int *face_indices,
-    const float *positions, float *normals, const int *remapped_indices, const int face_count, const int remapped_count,
-    const int orig_point_count)
-{
-
-    std::vector<abcV3> tmp_normals(orig_point_count, {0.f, 0.f, 0.f});
-    for (size_t i = 0; i < face_count; ++i) {
-        int face_vert_count = face_vertex_counts[i];
-        int face_start_index = face_start_offsets[i];
-        if (face_vert_count < 3) {
-            continue;
-        }
-        for (int tri = 0; tri < face_vert_count - 2; ++tri) {
-            int i1 = face_indices[face_start_index + tri];
-            int i2 = face_indices[face_start_index + tri + 1];
-            int i3 = face_indices[face_start_index + tri + 2];
-            abcV3 p1 = reinterpret_cast<const abcV3*>(positions)[i1];
-            abcV3 p2 = reinterpret_cast<const abcV3*>(positions)[i2];
-            abcV3 p3 = reinterpret_cast<const abcV3*>(positions)[i3];
-            abcV3 tri_normal = (p3 - p1).cross(p2 - p1);
-            tmp_normals[i1] += tri_normal;
-            tmp_normals[i2] += tri_normal;
-            tmp_normals[i3] += tri_normal;
-        }
-    }
-    for (size_t i = 0; i < remapped_count; ++i) {
-        int remap = remapped_indices[i];
-        abcV3 n = tmp_normals[remap].normalize();
-        reinterpret_cast<abcV3*>(normals)[i] = abcV3{ -n.x, n.y, n.z};
-    }
-}
-
 // > generic implementation
 
 
@@ -254,11 +476,76 @@ void Lerp(abcC4 *dst, const abcC4 *v1, const abcC4 *v2, int num, float w)
     Impl(Lerp, dst, v1, v2, num, w);
 }
 
+void RemapTransform(abcV2 *dst, const abcV2 *src, const int *indices, int num, const abcV2& mul)
+{
+    Impl(RemapTransform, dst, src, indices, num, mul);
+}
+
+void RemapTransform(abcV3 *dst, const abcV3 *src, const int *indices, int num, const abcV3& mul)
+{
+    Impl(RemapTransform, dst, src, indices, num, mul);
+}
+
+void RemapTransform(abcC4 *dst, const abcC4 *src, const int *indices, int num, const abcC4& mul)
+{
+    Impl(RemapTransform, dst, src, indices, num, mul);
+}
+
+void RemapTransform(abcV2 *dst1, abcV2 *dst2, const abcV2 *src1, const abcV2 *src2, const int *indices, int num, const abcV2& mul)
+{
+    Impl(RemapTransform, dst1, dst2, src1, src2, indices, num, mul);
+}
+
+void RemapTransform(abcV3 *dst1, abcV3 *dst2, const abcV3 *src1, const abcV3 *src2, const int *indices, int num, const abcV3& mul)
+{
+    Impl(RemapTransform, dst1, dst2, src1, src2, indices, num, mul);
+}
+
+void RemapTransform(abcC4 *dst1, abcC4 *dst2, const abcC4 *src1, const abcC4 *src2, const int *indices, int num, const abcC4& mul)
+{
+    Impl(RemapTransform, dst1, dst2, src1, src2, indices, num, mul);
+}
+
 void GenerateVelocities(abcV3 *dst, const abcV3 *p1, const abcV3 *p2, int num, float motion_scale)
 {
     Impl(GenerateVelocities, dst, p1, p2, num, motion_scale);
 }
 
+void Expand(abcV4 *dst, const abcV3 *src, int num, float w)
+{
+    Impl(Expand, dst, src, num, w);
+}
+
+void Expand(abcC4 *dst, const abcC3 *src, int num, float w)
+{
+    Impl(Expand, dst, src, num, w);
+}
+
+void Encode(snorm16x2 *dst, const abcV3 *src, int num)
+{
+    Impl(Encode, dst, src, num);
+}
+
+void Encode(snorm16x4 *dst, const abcV4 *src, int num)
+{
+    Impl(Encode, dst, src, num);
+}
+
+void Encode(half16x2 *dst, const abcV2 *src, int num)
+{
+    Impl(Encode, dst, src, num);
+}
+
+void Encode(unorm8x4 *dst, const abcC4 *src, int num)
+{
+    Impl(Encode, dst, src, num);
+}
+
+void Encode(unorm8x4 *dst, const abcC3 *src, int num)
+{
+    Impl(Encode, dst, src, num);
+}
+
 void MinMax(abcV3 &min, abcV3 &max, const abcV3 *points, int num)
 {
     Impl(MinMax, min, max, points, num);
@@ -271,15 +558,95 @@ void GenerateTangents(abcV4 *dst,
     Impl(GenerateTangents, dst, points, uv, normals, indices, num_points, num_triangles);
 }
 
-void GeneratePointNormals(const int *face_vertex_counts, const int *face_indices, const abcV3 *points, abcV3 *normals,
-        const int *remapped_point_indices, const int face_count, const int remapped_count, const int orig_point_count)
+void GenerateTangents(abcV4 *dst_,
+    const abcV3 *points_, const abcV2 *uv_, const abcV3 *normals_, const int *indices,
+    int num_points, int num_triangles, int num_workers)
 {
-    std::vector<int> face_start_indices(face_count);
-    std::partial_sum(face_vertex_counts, face_vertex_counts + face_count - 1, face_start_indices.begin() + 1);
-    memset(normals, 0, remapped_count * 3 * sizeof(float));
-    Impl(GeneratePointNormals, face_start_indices.data(), face_vertex_counts, face_indices,
-            reinterpret_cast<const float*>(points), reinterpret_cast<float*>(normals),
-            remapped_point_indices, face_count, remapped_count, orig_point_count);
+    const int min_triangles = 16384; // per partition. smaller ones don't pay off the extra buffers
+    const int max_partitions = 8;
+    const int block_size = 4096;
+
+    // the partitioning only depends on the mesh, so sums are added in the same order on any number of workers
+    num_workers = aiResolveWorkerCount(num_workers);
+    int num_partitions = std::min(max_partitions, num_triangles / min_triangles);
+    if (num_partitions <= 1)
+    {
+        GenerateTangents(dst_, points_, uv_, normals_, indices, num_points, num_triangles);
+        return;
+    }
+
+    auto *dst = (float4*)dst_;
+    auto *points = (const float3*)points_;
+    auto *uv = (const float2*)uv_;
+    auto *normals = (const float3*)normals_;
+
+    // each partition accumulates a range of triangles into its own buffers, so no two threads write the same
+    // element. refined triangles reference nearby vertices, so buffers only cover the index range actually touched
+    struct Partition
+    {
+        int vertex_begin = 0;
+        int vertex_end = 0;
+        RawVector<float3> tangents, binormals;
+    };
+    std::vector<Partition> partitions(num_partitions);
+
+    aiParallelFor(num_partitions, num_workers, [&](int pi) {
+        auto& part = partitions[pi];
+        int tri_begin = (int)((int64_t)num_triangles * pi / num_partitions);
+        int tri_end = (int)((int64_t)num_triangles * (pi + 1) / num_partitions);
+
+        int vmin = num_points, vmax = -1;
+        for (int ii = tri_begin * 3; ii < tri_end * 3; ++ii)
+        {
+            vmin = std::min(vmin, indices[ii]);
+            vmax = std::max(vmax, indices[ii]);
+        }
+        if (vmax < vmin)
+            return;
+        part.vertex_begin = vmin;
+        part.vertex_end = vmax + 1;
+        part.tangents.resize_zeroclear(vmax - vmin + 1);
+        part.binormals.resize_zeroclear(vmax - vmin + 1);
+
+        float3 *tangents = part.tangents.data() - vmin;
+        float3 *binormals = part.binormals.data() - vmin;
+        for (int ti = tri_begin; ti < tri_end; ++ti)
+        {
+            int ti3 = ti * 3;
+            int idx[3] = { indices[ti3 + 0], indices[ti3 + 1], indices[ti3 + 2] };
+            float3 v[3] = { points[idx[0]], points[idx[1]], points[idx[2]] };
+            float2 u[3] = { uv[idx[0]], uv[idx[1]], uv[idx[2]] };
+            float3 t[3];
+            float3 b[3];
+            compute_triangle_tangent(v, u, t, b);
+
+            for (int i = 0; i < 3; ++i)
+            {
+                tangents[idx[i]] += t[i];
+                binormals[idx[i]] += b[i];
+            }
+        }
+    });
+
+    // sum partitions in a fixed order, so results don't depend on scheduling
+    aiParallelFor((num_points + block_size - 1) / block_size, num_workers, [&](int bi) {
+        int begin = bi * block_size;
+        int end = std::min(begin + block_size, num_points);
+        for (int vi = begin; vi < end; ++vi)
+        {
+            float3 t = float3::zero();
+            float3 b = float3::zero();
+            for (auto& part : partitions)
+            {
+                if (vi >= part.vertex_begin && vi < part.vertex_end)
+                {
+                    t += part.tangents[vi - part.vertex_begin];
+                    b += part.binormals[vi - part.vertex_begin];
+                }
+            }
+            dst[vi] = orthogonalize_tangent(t, b, normals[vi]);
+        }
+    });
 }
 
 #undef Impl
@@ -167,6 +167,12 @@ using quatf = tquat<float>;
 using float3x3 = tmat3x3<float>;
 using float4x4 = tmat4x4<float>;
 
+// storage of quantized vertex attributes
+using snorm16x2 = tvec2<int16_t>;
+using snorm16x4 = tvec4<int16_t>;
+using half16x2 = tvec2<uint16_t>; // IEEE half bits
+using unorm8x4 = tvec4<uint8_t>;
+
 using double2 = tvec2<double>;
 using double3 = tvec3<double>;
 using double4 = tvec4<double>;
@@ -1428,11 +1434,36 @@ void Normalize(abcV3 *dst, int num);
 void Lerp(abcV2 *dst, const abcV2 *v1, const abcV2 *v2, int num, float w);
 void Lerp(abcV3 *dst, const abcV3 *v1, const abcV3 *v2, int num, float w);
 void Lerp(abcC4 *dst, const abcC4 *v1, const abcC4 *v2, int num, float w);
+// dst[i] = src[indices[i]] * mul in one pass. indices can be null. mul carries the handedness flip and scale
+void RemapTransform(abcV2 *dst, const abcV2 *src, const int *indices, int num, const abcV2& mul);
+void RemapTransform(abcV3 *dst, const abcV3 *src, const int *indices, int num, const abcV3& mul);
+void RemapTransform(abcC4 *dst, const abcC4 *src, const int *indices, int num, const abcC4& mul);
+// the same for both samples of an interpolation pair
+void RemapTransform(abcV2 *dst1, abcV2 *dst2, const abcV2 *src1, const abcV2 *src2, const int *indices, int num, const abcV2& mul);
+void RemapTransform(abcV3 *dst1, abcV3 *dst2, const abcV3 *src1, const abcV3 *src2, const int *indices, int num, const abcV3& mul);
+void RemapTransform(abcC4 *dst1, abcC4 *dst2, const abcC4 *src1, const abcC4 *src2, const int *indices, int num, const abcC4& mul);
 void GenerateVelocities(abcV3 *dst, const abcV3 *p1, const abcV3 *p2, int num, float motion_scale);
+// dst[i] = { src[i], w }
+void Expand(abcV4 *dst, const abcV3 *src, int num, float w);
+void Expand(abcC4 *dst, const abcC3 *src, int num, float w);
 void MinMax(abcV3& min, abcV3& max, const abcV3 *points, int num);
 void GenerateTangents(abcV4 *dst,
     const abcV3 *points, const abcV2 *uv, const abcV3 *normals, const int *indices,
     int num_points, int num_triangles);
+// quantization. the destination type decides the encoding:
+// snorm16x2: octahedral normal. snorm16x4: octahedral tangent in xy, w in z (+-32767), 0 in w.
+// half16x2: IEEE half. unorm8x4: [0, 1] color, alpha is 255 for 3 component colors
+void Encode(snorm16x2 *dst, const abcV3 *src, int num);
+void Encode(snorm16x4 *dst, const abcV4 *src, int num);
+void Encode(half16x2 *dst, const abcV2 *src, int num);
+void Encode(unorm8x4 *dst, const abcC4 *src, int num);
+void Encode(unorm8x4 *dst, const abcC3 *src, int num);
+// splits triangles into up to 8 partitions run on num_workers threads, and reduces their sums. small meshes take the
+// path above. the partitioning only depends on num_triangles, so results are the same for any worker count. they can
+// differ in the last bits from the overload above
+void GenerateTangents(abcV4 *dst,
+    const abcV3 *points, const abcV2 *uv, const abcV3 *normals, const int *indices,
+    int num_points, int num_triangles, int num_workers);
 
 // for test and debug
 void ApplyScaleGeneric(abcV3 *dst, int num, float scale);
@@ -1445,8 +1476,34 @@ void LerpGeneric(abcC4 *dst, const abcC4 *v1, const abcC4 *v2, int num, float w)
 void LerpISPC(abcV2 *dst, const abcV2 *v1, const abcV2 *v2, int num, float w);
 void LerpISPC(abcV3 *dst, const abcV3 *v1, const abcV3 *v2, int num, float w);
 void LerpISPC(abcC4 *dst, const abcC4 *v1, const abcC4 *v2, int num, float w);
+void RemapTransformGeneric(abcV2 *dst, const abcV2 *src, const int *indices, int num, const abcV2& mul);
+void RemapTransformGeneric(abcV3 *dst, const abcV3 *src, const int *indices, int num, const abcV3& mul);
+void RemapTransformGeneric(abcC4 *dst, const abcC4 *src, const int *indices, int num, const abcC4& mul);
+void RemapTransformGeneric(abcV2 *dst1, abcV2 *dst2, const abcV2 *src1, const abcV2 *src2, const int *indices, int num, const abcV2& mul);
+void RemapTransformGeneric(abcV3 *dst1, abcV3 *dst2, const abcV3 *src1, const abcV3 *src2, const int *indices, int num, const abcV3& mul);
+void RemapTransformGeneric(abcC4 *dst1, abcC4 *dst2, const abcC4 *src1, const abcC4 *src2, const int *indices, int num, const abcC4& mul);
+void RemapTransformISPC(abcV2 *dst, const abcV2 *src, const int *indices, int num, const abcV2& mul);
+void RemapTransformISPC(abcV3 *dst, const abcV3 *src, const int *indices, int num, const abcV3& mul);
+void RemapTransformISPC(abcC4 *dst, const abcC4 *src, const int *indices, int num, const abcC4& mul);
+void RemapTransformISPC(abcV2 *dst1, abcV2 *dst2, const abcV2 *src1, const abcV2 *src2, const int *indices, int num, const abcV2& mul);
+void RemapTransformISPC(abcV3 *dst1, abcV3 *dst2, const abcV3 *src1, const abcV3 *src2, const int *indices, int num, const abcV3& mul);
+void RemapTransformISPC(abcC4 *dst1, abcC4 *dst2, const abcC4 *src1, const abcC4 *src2, const int *indices, int num, const abcC4& mul);
 void GenerateVelocitiesGeneric(abcV3 *dst, const abcV3 *p1, const abcV3 *p2, int num, float motion_scale);
 void GenerateVelocitiesISPC(abcV3 *dst, const abcV3 *p1, const abcV3 *p2, int num, float motion_scale);
+void ExpandGeneric(abcV4 *dst, const abcV3 *src, int num, float w);
+void ExpandGeneric(abcC4 *dst, const abcC3 *src, int num, float w);
+void ExpandISPC(abcV4 *dst, const abcV3 *src, int num, float w);
+void ExpandISPC(abcC4 *dst, const abcC3 *src, int num, float w);
+void EncodeGeneric(snorm16x2 *dst, const abcV3 *src, int num);
+void EncodeGeneric(snorm16x4 *dst, const abcV4 *src, int num);
+void EncodeGeneric(half16x2 *dst, const abcV2 *src, int num);
+void EncodeGeneric(unorm8x4 *dst, const abcC4 *src, int num);
+void EncodeGeneric(unorm8x4 *dst, const abcC3 *src, int num);
+void EncodeISPC(snorm16x2 *dst, const abcV3 *src, int num);
+void EncodeISPC(snorm16x4 *dst, const abcV4 *src, int num);
+void EncodeISPC(half16x2 *dst, const abcV2 *src, int num);
+void EncodeISPC(unorm8x4 *dst, const abcC4 *src, int num);
+void EncodeISPC(unorm8x4 *dst, const abcC3 *src, int num);
 void MinMaxGeneric(abcV3& min, abcV3& max, const abcV3 *points, int num);
 void MinMaxISPC(abcV3& min, abcV3& max, const abcV3 *points, int num);
 void GenerateTangentsGeneric(abcV4 *dst,
@@ -1455,11 +1512,3 @@ void GenerateTangentsGeneric(abcV4 *dst,
 void GenerateTangentsISPC(abcV4 *dst,
     const abcV3 *points, const abcV2 *uv, const abcV3 *normals, const int *indices,
     int num_points, int num_triangles);
-void GeneratePointNormals(const int *face_vertex_counts, const int *face_indices, const abcV3 *points, abcV3 *normals,
-    const int *remapped_point_indices, const int face_count, const int remapped_count, const int orig_point_count);
-void GeneratePointNormalsGeneric(const int *face_start_offsets, const int *face_vertex_counts, const int *face_indices,
-    const float *positions, float *normals, const int *remapped_points, const int face_count, const int remapped_count,
-    const int orig_point_count);
-void GeneratePointNormalsISPC(const int *face_start_offsets, const int *face_vertex_counts, const int *face_indices,
-    const float *positions, float *normals, const int *remapped_points, const int face_count, const int remapped_count,
-    const int orig_point_count);
@@ -1,10 +1,105 @@
 #include "pch.h"
 #include "aiMeshOps.h"
+#include "aiThreadPool.h"
 #include <unordered_set>
 
 
 namespace impl
 {
+    // attributes known at compile time. operations on the list expand to direct calls on each attribute
+    template<class... Attrs> struct AttributeList;
+
+    template<>
+    struct AttributeList<>
+    {
+        void prepare(int, int) {}
+        bool compare(int, int) { return true; }
+        bool compareCorners(int, int) { return true; }
+        void resize(int) {}
+        void emitAt(int, int) {}
+    };
+
+    template<class Attr, class... Rest>
+    struct AttributeList<Attr, Rest...>
+    {
+        Attr *head;
+        AttributeList<Rest...> tail;
+
+        AttributeList(Attr *h, Rest*... rest) : head(h), tail(rest...) {}
+
+        // qualified calls bypass virtual dispatch
+        void prepare(int vertex_count, int index_count)
+        {
+            head->Attr::prepare(vertex_count, index_count);
+            tail.prepare(vertex_count, index_count);
+        }
+        bool compare(int ni, int ii)
+        {
+            return head->Attr::compare(ni, ii) && tail.compare(ni, ii);
+        }
+        bool compareCorners(int ii1, int ii2)
+        {
+            return head->Attr::compareCorners(ii1, ii2) && tail.compareCorners(ii1, ii2);
+        }
+        void resize(int vertex_count)
+        {
+            head->Attr::resize(vertex_count);
+            tail.resize(vertex_count);
+        }
+        void emitAt(int ni, int ii)
+        {
+            head->Attr::emitAt(ni, ii);
+            tail.emitAt(ni, ii);
+        }
+    };
+
+    // accumulates faces of the current split and closes it as MeshRefiner::Split
+    struct SplitBuilder
+    {
+        int offset_faces = 0;
+        int offset_indices = 0;
+        int offset_vertices = 0;
+        int num_faces = 0;
+        int num_indices_tri = 0;
+        int num_indices_lines = 0;
+        int num_indices_points = 0;
+
+        void addFace(int count)
+        {
+            ++num_faces;
+            if (count >= 3)
+                num_indices_tri += (count - 2) * 3;
+            else if (count == 2)
+                num_indices_lines += 2;
+            else if (count == 1)
+                num_indices_points += 1;
+        }
+
+        void addSplit(RawVector<MeshRefiner::Split>& splits, int num_vertices, int num_indices)
+        {
+            auto split = MeshRefiner::Split{};
+            split.face_offset = offset_faces;
+            split.index_offset = offset_indices;
+            split.vertex_offset = offset_vertices;
+            split.face_count = num_faces;
+            split.index_count_tri = num_indices_tri;
+            split.index_count_lines = num_indices_lines;
+            split.index_count_points = num_indices_points;
+            split.vertex_count = num_vertices - offset_vertices;
+            split.index_count = num_indices - offset_indices;
+            splits.push_back(split);
+
+            offset_faces += split.face_count;
+            offset_indices += split.index_count;
+            offset_vertices += split.vertex_count;
+
+            num_faces = 0;
+            num_indices_tri = 0;
+            num_indices_lines = 0;
+            num_indices_points = 0;
+        }
+    };
+
     template<class Indices, class Counts>
     inline void BuildConnection(
         MeshConnectionInfo& connection, const Indices& indices, const Counts& counts, const IArray<float3>& vertices)
@@ -57,6 +152,83 @@ namespace impl
     }
 }
 
+void GeneratePointNormals(const MeshConnectionInfo& connection, const IArray<int>& counts, const IArray<int>& indices,
+    const IArray<float3>& points, const IArray<int>& remap, float3 *dst, int num_workers)
+{
+    const int block_size = 4096;
+    auto num_blocks = [&](int n) { return (n + block_size - 1) / block_size; };
+
+    int num_faces = (int)counts.size();
+    int num_points = (int)points.size();
+    int num_dst = (int)remap.size();
+
+    RawVector<int> face_offsets, tri_offsets;
+    face_offsets.resize_discard(num_faces);
+    tri_offsets.resize_discard(num_faces);
+    int num_triangles = 0;
+    {
+        int offset = 0;
+        for (int fi = 0; fi < num_faces; ++fi)
+        {
+            int count = counts[fi];
+            face_offsets[fi] = offset;
+            tri_offsets[fi] = num_triangles;
+            offset += count;
+            num_triangles += std::max(count - 2, 0);
+        }
+    }
+
+    RawVector<float3> tri_normals;
+    tri_normals.resize_discard(num_triangles);
+    aiParallelFor(num_blocks(num_faces), num_workers, [&](int bi) {
+        int end = std::min((bi + 1) * block_size, num_faces);
+        for (int fi = bi * block_size; fi < end; ++fi)
+        {
+            const int *face = &indices[face_offsets[fi]];
+            float3 *dst_normals = &tri_normals[tri_offsets[fi]];
+            int num_face_triangles = counts[fi] - 2;
+            for (int ti = 0; ti < num_face_triangles; ++ti)
+            {
+                float3 p1 = points[face[ti]];
+                float3 p2 = points[face[ti + 1]];
+                float3 p3 = points[face[ti + 2]];
+                dst_normals[ti] = cross(p3 - p1, p2 - p1);
+            }
+        }
+    });
+
+    // corner k of a face belongs to triangles k-2 ... k. connected faces are in face order, so the sums are in the
+    // order a sequential scatter would add them
+    RawVector<float3> point_normals;
+    point_normals.resize_discard(num_points);
+    aiParallelFor(num_blocks(num_points), num_workers, [&](int bi) {
+        int end = std::min((bi + 1) * block_size, num_points);
+        for (int pi = bi * block_size; pi < end; ++pi)
+        {
+            float3 n = float3::zero();
+            connection.eachConnectedFaces(pi, [&](int fi, int ii) {
+                int count = counts[fi];
+                int k = ii - face_offsets[fi];
+                int first = std::max(k - 2, 0);
+                int last = std::min(k, count - 3);
+                for (int ti = first; ti <= last; ++ti)
+                    n += tri_normals[tri_offsets[fi] + ti];
+            });
+            float len = length(n);
+            point_normals[pi] = len != 0.0f ? n / len : n;
+        }
+    });
+
+    aiParallelFor(num_blocks(num_dst), num_workers, [&](int bi) {
+        int end = std::min((bi + 1) * block_size, num_dst);
+        for (int i = bi * block_size; i < end; ++i)
+        {
+            float3 n = point_normals[remap[i]];
+            dst[i] = { -n.x, n.y, n.z };
+        }
+    });
+}
+
 void MeshConnectionInfo::clear()
 {
     v2f_counts.clear();
@@ -408,11 +580,55 @@ void MeshRefiner::setupSubmeshes()
             sm.submesh_index = smi;
         }
     }
+
+    new_indices_submeshes16.clear();
+    if (index16)
+        narrowSubmeshIndices();
+}
+
+void MeshRefiner::narrowSubmeshIndices()
+{
+    const int max_vertices = 0xffff;
+    auto narrow = [&](const Submesh& sm) { return splits[sm.split_index].vertex_count <= max_vertices; };
+
+    size_t num_narrow = 0, num_wide = 0;
+    for (auto& sm : submeshes)
+        (narrow(sm) ? num_narrow : num_wide) += sm.index_count;
+    if (num_narrow == 0)
+        return;
+
+    // indices are relative to the split, so narrowing is a plain conversion
+    RawVector<int> wide;
+    wide.resize_discard(num_wide);
+    new_indices_submeshes16.resize_discard(num_narrow);
+    int offset_narrow = 0, offset_wide = 0;
+    for (auto& sm : submeshes)
+    {
+        const int *src = new_indices_submeshes.data() + sm.index_offset;
+        if (narrow(sm))
+        {
+            uint16_t *dst = new_indices_submeshes16.data() + offset_narrow;
+            for (int ii = 0; ii < sm.index_count; ++ii)
+                dst[ii] = (uint16_t)src[ii];
+            sm.index_offset = offset_narrow;
+            sm.index_size = 2;
+            offset_narrow += sm.index_count;
+        }
+        else
+        {
+            memcpy(wide.data() + offset_wide, src, sizeof(int) * sm.index_count);
+            sm.index_offset = offset_wide;
+            offset_wide += sm.index_count;
+        }
+    }
+    new_indices_submeshes.swap(wide);
 }
 
 void MeshRefiner::clear()
 {
     split_unit = 0;
+    worker_count = 1;
+    index16 = false;
     counts.reset();
     indices.reset();
     points.reset();
@@ -432,6 +648,7 @@ void MeshRefiner::clear()
     new_indices_lines.clear();
     new_indices_points.clear();
     new_indices_submeshes.clear();
+    new_indices_submeshes16.clear();
 
     new_points.clear();
     splits.clear();
@@ -439,60 +656,118 @@ void MeshRefiner::clear()
     connection.clear();
 }
 
+// any set of attributes, through IAttribute
+struct MeshRefiner::DynamicAttributeList
+{
+    RawVector<IAttribute*>& attributes;
+
+    void prepare(int vertex_count, int index_count)
+    {
+        for (auto& attr : attributes)
+            attr->prepare(vertex_count, index_count);
+    }
+    bool compare(int ni, int ii)
+    {
+        for (auto& attr : attributes)
+            if (!attr->compare(ni, ii)) { return false; }
+        return true;
+    }
+    bool compareCorners(int ii1, int ii2)
+    {
+        for (auto& attr : attributes)
+            if (!attr->compareCorners(ii1, ii2)) { return false; }
+        return true;
+    }
+    void resize(int vertex_count)
+    {
+        for (auto& attr : attributes)
+            attr->resize(vertex_count);
+    }
+    void emitAt(int ni, int ii)
+    {
+        for (auto& attr : attributes)
+            attr->emitAt(ni, ii);
+    }
+};
+
+template<class... Bound>
+bool MeshRefiner::refineFused(TypeList<>, Bound*... bound)
+{
+    if (sizeof...(Bound) != attributes.size())
+        return false;
+    impl::AttributeList<Bound...> attrs(bound...);
+    refineWith(attrs);
+    return true;
+}
+
+template<class T, class... Ts, class... Bound>
+bool MeshRefiner::refineFused(TypeList<T, Ts...>, Bound*... bound)
+{
+    size_t i = sizeof...(Bound);
+    if (i >= attributes.size())
+        return false;
+    if (auto *attr = dynamic_cast<IndexedAttribute<T>*>(attributes[i]))
+        return refineFused(TypeList<Ts...>(), bound..., attr);
+    if (auto *attr = dynamic_cast<ExpandedAttribute<T>*>(attributes[i]))
+        return refineFused(TypeList<Ts...>(), bound..., attr);
+    return false;
+}
+
 void MeshRefiner::refine()
 {
-    if (connection.v2f_counts.size() != points.size())
+    if (hash_dedup)
     {
-        connection.buildConnection(indices, counts, points);
+        refineHashed();
+        return;
     }
 
-    int num_indices = (int)indices.size();
-    new_points.reserve(num_indices);
-    new_indices.reserve(num_indices);
-    for (auto& attr : attributes)
+    // common attribute sets (P, P+N, P+N+UV0, P+N+UV0+C) are refined with fused loops. others go through IAttribute
+    bool fused = fuse_attributes && (
+        refineFused(TypeList<>()) ||
+        refineFused(TypeList<abcV3>()) ||
+        refineFused(TypeList<abcV3, abcV2>()) ||
+        refineFused(TypeList<abcV3, abcV2, abcC4>()));
+    if (!fused)
     {
-        attr->prepare((int)points.size(), (int)indices.size());
+        DynamicAttributeList attrs{ attributes };
+        refineWith(attrs);
     }
+}
 
-    old2new_indices.resize(num_indices, -1);
+template<class AttrList>
+void MeshRefiner::refineWith(AttrList& attrs)
+{
+    // meshes that are large enough and fit in one split are refined in parallel. others and fallbacks go serial
+    const int min_parallel_indices = 0x10000;
+    int num_indices = (int)indices.size();
+    bool one_split = split_unit <= 0 || (int)points.size() <= split_unit;
+    if (aiResolveWorkerCount(worker_count) > 1 && num_indices >= min_parallel_indices && one_split && refineParallel(attrs))
+        return;
+    refineSerial(attrs);
+}
 
-    int num_faces_total = (int)counts.size();
-    int offset_faces = 0;
-    int offset_indices = 0;
-    int offset_vertices = 0;
-    int num_faces = 0;
-    int num_indices_tri = 0;
-    int num_indices_lines = 0;
-    int num_indices_points = 0;
-
-    auto add_new_split = [&]() {
-            auto split = Split{};
-            split.face_offset = offset_faces;
-            split.index_offset = offset_indices;
-            split.vertex_offset = offset_vertices;
-            split.face_count = num_faces;
-            split.index_count_tri = num_indices_tri;
-            split.index_count_lines = num_indices_lines;
-            split.index_count_points = num_indices_points;
-            split.vertex_count = (int)new_points.size() - offset_vertices;
-            split.index_count = (int)new_indices.size() - offset_indices;
-            splits.push_back(split);
+template<class AttrList>
+void MeshRefiner::refineSerial(AttrList& attrs)
+{
+    if (connection.v2f_counts.size() != points.size())
+    {
+        connection.buildConnection(indices, counts, points);
+    }
 
-            offset_faces += split.face_count;
-            offset_indices += split.index_count;
-            offset_vertices += split.vertex_count;
+    // there can't be more vertices than indices. allocate outputs once and shrink them at the end
+    int num_indices = (int)indices.size();
+    new_points.resize_discard(num_indices);
+    new2old_points.resize_discard(num_indices);
+    new_indices.resize_discard(num_indices);
+    attrs.prepare((int)points.size(), num_indices);
+    attrs.resize(num_indices);
 
-            num_faces = 0;
-            num_indices_tri = 0;
-            num_indices_lines = 0;
-            num_indices_points = 0;
-        };
+    old2new_indices.resize(num_indices, -1);
 
-    auto compare_all_attributes = [&](int ni, int ii) -> bool {
-            for (auto& attr : attributes)
-                if (!attr->compare(ni, ii)) { return false; }
-            return true;
-        };
+    int num_faces_total = (int)counts.size();
+    int num_vertices = 0;
+    int num_new_indices = 0;
+    impl::SplitBuilder sb;
 
     auto find_or_emit_vertex = [&](int vi, int ii) -> int {
             int offset = connection.v2f_offsets[vi];
@@ -500,19 +775,16 @@ void MeshRefiner::refine()
             for (int ci = 0; ci < connection_count; ++ci)
             {
                 int& ni = old2new_indices[connection.v2f_indices[offset + ci]];
-                if (ni != -1 && compare_all_attributes(ni, ii))
+                if (ni != -1 && attrs.compare(ni, ii))
                 {
                     return ni;
                 }
                 else
                 {
-                    ni = (int)new_points.size();
-                    new_points.push_back(points[vi]);
-                    new2old_points.push_back(vi);
-                    for (auto& attr : attributes)
-                    {
-                        attr->emit(ii);
-                    }
+                    ni = num_vertices++;
+                    new_points[ni] = points[vi];
+                    new2old_points[ni] = vi;
+                    attrs.emitAt(ni, ii);
                     return ni;
                 }
             }
@@ -525,9 +797,9 @@ void MeshRefiner::refine()
         int count = counts[fi];
         if ((count >= 3 && gen_triangles) || (count == 2 && gen_lines) || (count == 1 && gen_points))
         {
-            if (split_unit > 0 && (int)new_points.size() - offset_vertices + count > split_unit)
+            if (split_unit > 0 && num_vertices - sb.offset_vertices + count > split_unit)
             {
-                add_new_split();
+                sb.addSplit(splits, num_vertices, num_new_indices);
 
                 // clear vertex cache
                 memset(old2new_indices.data(), -1, old2new_indices.size() * sizeof(int));
@@ -537,17 +809,328 @@ void MeshRefiner::refine()
             {
                 int ii = offset + ci;
                 int vi = indices[ii];
-                new_indices.push_back(find_or_emit_vertex(vi, ii));
+                new_indices[num_new_indices++] = find_or_emit_vertex(vi, ii);
             }
-            ++num_faces;
-            if (count >= 3)
-                num_indices_tri += (count - 2) * 3;
-            else if (count == 2)
-                num_indices_lines += 2;
-            else if (count == 1)
-                num_indices_points += 1;
+            sb.addFace(count);
+        }
+        offset += count;
+    }
+    sb.addSplit(splits, num_vertices, num_new_indices);
+
+    new_points.resize(num_vertices);
+    new2old_points.resize(num_vertices);
+    new_indices.resize(num_new_indices);
+    attrs.resize(num_vertices);
+}
+
+// produces exactly what refineSerial() does when all faces go to one split.
+// refineSerial() keeps one "last emitted vertex" per original vertex and reuses it if all attributes match.
+// faces are split into chunks that run that logic locally. the first touch of a vertex in a chunk can't be resolved
+// locally, so it is emitted provisionally and resolved against the previous chunks in a short sequential pass.
+template<class AttrList>
+bool MeshRefiner::refineParallel(AttrList& attrs)
+{
+    struct Chunk
+    {
+        int face_begin = 0, face_end = 0, index_begin = 0;
+        int max_count = 0;
+        impl::SplitBuilder faces; // face and index counts of the chunk
+        int corner_offset = 0; // in new_indices
+
+        RawVector<int> corner_emissions;    // local emission for each output corner
+        RawVector<int> emission_src;        // index that emitted it
+        RawVector<char> emission_first;     // first touch of the vertex in this chunk
+        RawVector<int> emission_ids;        // resolved new vertex index. -1 if not emitted by this chunk
+        RawVector<int> table_keys, table_values; // vertex -> last local emission
+    };
+
+    int num_points = (int)points.size();
+    int num_indices = (int)indices.size();
+    int num_faces_total = (int)counts.size();
+    int num_workers = aiResolveWorkerCount(worker_count);
+    int num_chunks = std::max(std::min(num_workers * 4, num_indices / 0x4000), 1);
+
+    // offsets of each face in indices
+    RawVector<int> face_offsets;
+    face_offsets.resize_discard(num_faces_total + 1);
+    {
+        int offset = 0;
+        for (int fi = 0; fi < num_faces_total; ++fi)
+        {
+            face_offsets[fi] = offset;
+            offset += counts[fi];
+        }
+        face_offsets[num_faces_total] = offset;
+    }
+
+    std::vector<Chunk> chunks(num_chunks);
+    for (int ci = 0; ci < num_chunks; ++ci)
+    {
+        auto& chunk = chunks[ci];
+        chunk.face_begin = (int)((int64_t)num_faces_total * ci / num_chunks);
+        chunk.face_end = (int)((int64_t)num_faces_total * (ci + 1) / num_chunks);
+        chunk.index_begin = face_offsets[chunk.face_begin];
+    }
+
+    // phase 1: refine each chunk locally
+    aiParallelFor(num_chunks, num_workers, [&](int ci) {
+        auto& chunk = chunks[ci];
+        int chunk_indices = face_offsets[chunk.face_end] - chunk.index_begin;
+
+        int table_size = 16;
+        while (table_size < chunk_indices * 2)
+            table_size *= 2;
+        int table_mask = table_size - 1;
+        chunk.table_keys.resize(table_size, -1);
+        chunk.table_values.resize_discard(table_size);
+        chunk.corner_emissions.reserve(chunk_indices);
+        chunk.emission_src.reserve(chunk_indices);
+        chunk.emission_first.reserve(chunk_indices);
+
+        for (int fi = chunk.face_begin; fi < chunk.face_end; ++fi)
+        {
+            int count = counts[fi];
+            if (!((count >= 3 && gen_triangles) || (count == 2 && gen_lines) || (count == 1 && gen_points)))
+                continue;
+
+            int offset = face_offsets[fi];
+            for (int ci = 0; ci < count; ++ci)
+            {
+                int ii = offset + ci;
+                int vi = indices[ii];
+
+                int slot = (int)(((uint32_t)vi * 2654435761u) & (uint32_t)table_mask);
+                while (chunk.table_keys[slot] != -1 && chunk.table_keys[slot] != vi)
+                    slot = (slot + 1) & table_mask;
+
+                bool first = chunk.table_keys[slot] == -1;
+                int ei = first ? -1 : chunk.table_values[slot];
+                if (first || !attrs.compareCorners(chunk.emission_src[ei], ii))
+                {
+                    ei = (int)chunk.emission_src.size();
+                    chunk.emission_src.push_back(ii);
+                    chunk.emission_first.push_back(first ? 1 : 0);
+                    chunk.table_keys[slot] = vi;
+                    chunk.table_values[slot] = ei;
+                }
+                chunk.corner_emissions.push_back(ei);
+            }
+            chunk.faces.addFace(count);
+            chunk.max_count = std::max(chunk.max_count, count);
+        }
+    });
+
+    // phase 2: resolve first touches against the previous chunks and assign new vertex indices in serial order
+    RawVector<int> last_src, last_id;
+    last_src.resize(num_points, -1);
+    last_id.resize_discard(num_points);
+
+    int num_vertices = 0;
+    int num_new_indices = 0;
+    int max_count = 0;
+    for (auto& chunk : chunks)
+    {
+        int num_emissions = (int)chunk.emission_src.size();
+        chunk.emission_ids.resize_discard(num_emissions);
+        for (int ei = 0; ei < num_emissions; ++ei)
+        {
+            int ii = chunk.emission_src[ei];
+            if (chunk.emission_first[ei])
+            {
+                int src = last_src[indices[ii]];
+                if (src != -1 && attrs.compareCorners(src, ii))
+                {
+                    // the vertex of the previous chunk is reused. -(id + 2) marks it as not emitted here
+                    chunk.emission_ids[ei] = -(last_id[indices[ii]] + 2);
+                    continue;
+                }
+            }
+            chunk.emission_ids[ei] = num_vertices++;
+        }
+
+        int table_size = (int)chunk.table_keys.size();
+        for (int slot = 0; slot < table_size; ++slot)
+        {
+            int vi = chunk.table_keys[slot];
+            if (vi == -1)
+                continue;
+            int ei = chunk.table_values[slot];
+            int id = chunk.emission_ids[ei];
+            if (id >= 0)
+            {
+                last_src[vi] = chunk.emission_src[ei];
+                last_id[vi] = id;
+            }
+        }
+        chunk.table_keys.clear();
+        chunk.table_values.clear();
+
+        chunk.corner_offset = num_new_indices;
+        num_new_indices += (int)chunk.corner_emissions.size();
+        max_count = std::max(max_count, chunk.max_count);
+    }
+
+    // refineSerial() would have started another split. let it handle this mesh
+    if (split_unit > 0 && (int64_t)num_vertices + max_count > split_unit)
+        return false;
+
+    // phase 3: write outputs
+    new_points.resize_discard(num_vertices);
+    new2old_points.resize_discard(num_vertices);
+    new_indices.resize_discard(num_new_indices);
+    attrs.prepare(num_points, num_indices);
+    attrs.resize(num_vertices);
+
+    aiParallelFor(num_chunks, num_workers, [&](int ci) {
+        auto& chunk = chunks[ci];
+        int num_emissions = (int)chunk.emission_src.size();
+        for (int ei = 0; ei < num_emissions; ++ei)
+        {
+            int id = chunk.emission_ids[ei];
+            if (id < 0)
+                continue;
+            int ii = chunk.emission_src[ei];
+            int vi = indices[ii];
+            new_points[id] = points[vi];
+            new2old_points[id] = vi;
+            attrs.emitAt(id, ii);
+        }
+
+        int num_corners = (int)chunk.corner_emissions.size();
+        int *dst = new_indices.data() + chunk.corner_offset;
+        for (int ci = 0; ci < num_corners; ++ci)
+        {
+            int id = chunk.emission_ids[chunk.corner_emissions[ci]];
+            dst[ci] = id >= 0 ? id : -id - 2;
+        }
+    });
+
+    auto split = Split{};
+    for (auto& chunk : chunks)
+    {
+        split.face_count += chunk.faces.num_faces;
+        split.index_count_tri += chunk.faces.num_indices_tri;
+        split.index_count_lines += chunk.faces.num_indices_lines;
+        split.index_count_points += chunk.faces.num_indices_points;
+    }
+    split.vertex_count = num_vertices;
+    split.index_count = num_new_indices;
+    splits.push_back(split);
+    return true;
+}
+
+// dedups (point index, attribute values) tuples with an open addressing table. unlike refineSerial(), a corner can
+// reuse any earlier vertex of the split, not only the last one emitted for its point. no connection info is needed.
+void MeshRefiner::refineHashed()
+{
+    int num_indices = (int)indices.size();
+    for (auto& attr : attributes)
+        attr->prepare((int)points.size(), num_indices);
+
+    // one row of words per index: point index followed by the values of each attribute
+    int num_words = 1;
+    for (auto& attr : attributes)
+        num_words += attr->getKeySize();
+
+    RawVector<uint32_t> keys;
+    keys.resize_zeroclear((size_t)num_indices * num_words);
+    for (int ii = 0; ii < num_indices; ++ii)
+        keys[(size_t)ii * num_words] = (uint32_t)indices[ii];
+    int word_offset = 1;
+    for (auto& attr : attributes)
+    {
+        attr->gatherKeys(keys.data() + word_offset, num_words);
+        word_offset += attr->getKeySize();
+    }
+
+    // fixed row sizes let the compiler unroll hashing and comparison
+    switch (num_words)
+    {
+    case 1: refineHashedImpl<1>(keys, num_words); break;
+    case 2: refineHashedImpl<2>(keys, num_words); break;
+    case 3: refineHashedImpl<3>(keys, num_words); break;
+    case 4: refineHashedImpl<4>(keys, num_words); break;
+    case 5: refineHashedImpl<5>(keys, num_words); break;
+    case 6: refineHashedImpl<6>(keys, num_words); break;
+    case 7: refineHashedImpl<7>(keys, num_words); break;
+    case 8: refineHashedImpl<8>(keys, num_words); break;
+    case 9: refineHashedImpl<9>(keys, num_words); break;
+    case 10: refineHashedImpl<10>(keys, num_words); break;
+    case 11: refineHashedImpl<11>(keys, num_words); break;
+    case 12: refineHashedImpl<12>(keys, num_words); break;
+    case 13: refineHashedImpl<13>(keys, num_words); break;
+    case 14: refineHashedImpl<14>(keys, num_words); break;
+    case 15: refineHashedImpl<15>(keys, num_words); break;
+    case 16: refineHashedImpl<16>(keys, num_words); break;
+    default: refineHashedImpl<0>(keys, num_words); break;
+    }
+}
+
+template<int N>
+void MeshRefiner::refineHashedImpl(const RawVector<uint32_t>& keys, int num_words)
+{
+    const int stride = N > 0 ? N : num_words;
+    int num_indices = (int)indices.size();
+    int num_faces_total = (int)counts.size();
+
+    int table_size = 16;
+    while (table_size < num_indices * 2)
+        table_size *= 2;
+    uint32_t table_mask = (uint32_t)table_size - 1;
+
+    // new vertex index of each slot. slots holding vertices of previous splits count as empty
+    RawVector<int> table;
+    table.resize(table_size, -1);
+
+    RawVector<int> src_indices; // index that emitted each new vertex
+    src_indices.reserve(num_indices);
+    new_points.reserve(num_indices);
+    new2old_points.reserve(num_indices);
+    new_indices.reserve(num_indices);
+
+    impl::SplitBuilder sb;
+    auto find_or_emit_vertex = [&](int ii) -> int {
+        const uint32_t *key = &keys[(size_t)ii * stride];
+        uint32_t hash = 2166136261u;
+        for (int wi = 0; wi < stride; ++wi)
+            hash = (hash ^ key[wi]) * 16777619u;
+        hash ^= hash >> 15;
+
+        for (uint32_t slot = hash & table_mask; ; slot = (slot + 1) & table_mask)
+        {
+            int ni = table[slot];
+            if (ni < sb.offset_vertices)
+            {
+                ni = (int)new_points.size();
+                table[slot] = ni;
+                int vi = (int)key[0];
+                new_points.push_back(points[vi]);
+                new2old_points.push_back(vi);
+                src_indices.push_back(ii);
+                return ni;
+            }
+            if (memcmp(&keys[(size_t)src_indices[ni] * stride], key, sizeof(uint32_t) * stride) == 0)
+                return ni;
+        }
+    };
+
+    int offset = 0;
+    for (int fi = 0; fi < num_faces_total; ++fi)
+    {
+        int count = counts[fi];
+        if ((count >= 3 && gen_triangles) || (count == 2 && gen_lines) || (count == 1 && gen_points))
+        {
+            if (split_unit > 0 && (int)new_points.size() - sb.offset_vertices + count > split_unit)
+                sb.addSplit(splits, (int)new_points.size(), (int)new_indices.size());
+
+            for (int ci = 0; ci < count; ++ci)
+                new_indices.push_back(find_or_emit_vertex(offset + ci));
+            sb.addFace(count);
         }
         offset += count;
     }
-    add_new_split();
+    sb.addSplit(splits, (int)new_points.size(), (int)new_indices.size());
+
+    for (auto& attr : attributes)
+        attr->emitAll(src_indices);
 }
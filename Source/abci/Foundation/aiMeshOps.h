@@ -45,6 +45,12 @@ struct MeshConnectionInfo
     }
 };
 
+// smooth normals of remapped vertices (x flipped, as other cooked normals). polygons are split into triangles
+// (i, i+1, i+2). triangle normals are gathered per point through connection, so each point is written by one
+// thread and results are the same for any worker count.
+void GeneratePointNormals(const MeshConnectionInfo& connection, const IArray<int>& counts, const IArray<int>& indices,
+    const IArray<float3>& points, const IArray<int>& remap, float3 *dst, int num_workers);
+
 
 class MeshWelder
 {
@@ -86,7 +92,8 @@ struct MeshRefiner
         int split_index = 0;
         int submesh_index = 0; // submesh index in split
         int index_count = 0; // triangulated
-        int index_offset = 0;
+        int index_offset = 0; // in new_indices_submeshes16 if index_size is 2, new_indices_submeshes otherwise
+        int index_size = 4; // bytes per index
         int* dst_indices = nullptr;
     };
 
@@ -108,6 +115,10 @@ struct MeshRefiner
 
     // inputs
     int split_unit = 0; // 0 == no split
+    int worker_count = 1; // threads refine() can use. 0 or less: all available. the result is the same for any count
+    bool hash_dedup = false; // merge vertices with identical attributes through a hash table instead of the connection
+    bool fuse_attributes = true; // refine common attribute sets with fused loops. the result is the same either way
+    bool index16 = false; // submeshes of splits with up to 0xffff vertices get uint16 indices
     bool gen_points = true;
     bool gen_lines = true;
     bool gen_triangles = true;
@@ -124,6 +135,7 @@ struct MeshRefiner
     RawVector<int> new_indices_lines;
     RawVector<int> new_indices_points;
     RawVector<int> new_indices_submeshes;
+    RawVector<uint16_t> new_indices_submeshes16;
     RawVector<float3> new_points;
     RawVector<Split> splits;
     RawVector<Submesh> submeshes;
@@ -160,7 +172,18 @@ struct MeshRefiner
     int getPointsIndexCountTotal() const;
 
 private:
+    template<class... Ts> struct TypeList {};
+    struct DynamicAttributeList;
+
     void setupSubmeshes();
+    void narrowSubmeshIndices();
+    template<class... Bound> bool refineFused(TypeList<>, Bound*... bound);
+    template<class T, class... Ts, class... Bound> bool refineFused(TypeList<T, Ts...>, Bound*... bound);
+    template<class AttrList> void refineWith(AttrList& attrs);
+    template<class AttrList> void refineSerial(AttrList& attrs);
+    template<class AttrList> bool refineParallel(AttrList& attrs);
+    void refineHashed();
+    template<int N> void refineHashedImpl(const RawVector<uint32_t>& keys, int num_words);
 
     class IAttribute
     {
@@ -168,8 +191,17 @@ private:
         virtual ~IAttribute() {}
         virtual void prepare(int vertex_count, int index_count) = 0;
         virtual bool compare(int vertex_index, int index_index) = 0;
-        virtual void emit(int index_index) = 0;
         virtual void clear() = 0;
+
+        // outputs are resized to the upper bound before refine and emitAt() writes to them
+        virtual bool compareCorners(int index_index1, int index_index2) = 0;
+        virtual void resize(int vertex_count) = 0;
+        virtual void emitAt(int vertex_index, int index_index) = 0;
+
+        // for hashed dedup. gatherKeys() writes the value of each index to a row of 'stride' words
+        virtual int getKeySize() = 0; // in words
+        virtual void gatherKeys(uint32_t *dst, int stride) = 0;
+        virtual void emitAll(const RawVector<int>& src_indices) = 0;
     };
 
     template<class T>
@@ -186,17 +218,53 @@ private:
             return (*new_values)[ni] == values[indices[ii]];
         }
 
-        void emit(int ii) override
+        void clear() override
+        {
+            new_values->clear();
+            new2old->clear();
+        }
+
+        bool compareCorners(int ii1, int ii2) override
+        {
+            return values[indices[ii1]] == values[indices[ii2]];
+        }
+
+        void resize(int vertex_count) override
+        {
+            new_values->resize_discard(vertex_count);
+            new2old->resize_discard(vertex_count);
+        }
+
+        void emitAt(int ni, int ii) override
         {
             int i = indices[ii];
-            new_values->push_back(values[i]);
-            new2old->push_back(i);
+            (*new_values)[ni] = values[i];
+            (*new2old)[ni] = i;
         }
 
-        void clear() override
+        int getKeySize() override
         {
-            new_values->clear();
-            new2old->clear();
+            return (int)((sizeof(T) + 3) / 4);
+        }
+
+        void gatherKeys(uint32_t *dst, int stride) override
+        {
+            size_t n = indices.size();
+            for (size_t ii = 0; ii < n; ++ii)
+                memcpy(dst + ii * stride, &values[indices[ii]], sizeof(T));
+        }
+
+        void emitAll(const RawVector<int>& src_indices) override
+        {
+            size_t n = src_indices.size();
+            new_values->resize_discard(n);
+            new2old->resize_discard(n);
+            for (size_t ni = 0; ni < n; ++ni)
+            {
+                int i = indices[src_indices[ni]];
+                (*new_values)[ni] = values[i];
+                (*new2old)[ni] = i;
+            }
         }
 
         IArray<T> values;
@@ -219,15 +287,52 @@ private:
             return (*new_values)[ni] == values[ii];
         }
 
-        void emit(int ii) override
+        void clear() override
         {
-            new_values->push_back(values[ii]);
-            new2old->push_back(ii);
+            new_values->clear();
+            new2old->clear();
         }
 
-        void clear() override
+        bool compareCorners(int ii1, int ii2) override
         {
-            new_values->clear();
+            return values[ii1] == values[ii2];
+        }
+
+        void resize(int vertex_count) override
+        {
+            new_values->resize_discard(vertex_count);
+            new2old->resize_discard(vertex_count);
+        }
+
+        void emitAt(int ni, int ii) override
+        {
+            (*new_values)[ni] = values[ii];
+            (*new2old)[ni] = ii;
+        }
+
+        int getKeySize() override
+        {
+            return (int)((sizeof(T) + 3) / 4);
+        }
+
+        void gatherKeys(uint32_t *dst, int stride) override
+        {
+            size_t n = values.size();
+            for (size_t ii = 0; ii < n; ++ii)
+                memcpy(dst + ii * stride, &values[ii], sizeof(T));
+        }
+
+        void emitAll(const RawVector<int>& src_indices) override
+        {
+            size_t n = src_indices.size();
+            new_values->resize_discard(n);
+            new2old->resize_discard(n);
+            for (size_t ni = 0; ni < n; ++ni)
+            {
+                int ii = src_indices[ni];
+                (*new_values)[ni] = values[ii];
+                (*new2old)[ni] = ii;
+            }
         }
 
         IArray<T> values;
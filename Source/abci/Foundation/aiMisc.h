@@ -17,6 +17,16 @@ template<> inline abcV3 abcMax<abcV3>(const abcV3& a, const abcV3& b)
     return abcV3(std::max<float>(a.x, b.x), std::max<float>(a.y, b.y), std::max<float>(a.z, b.z));
 }
 
+// memory held by buffers. for memory budgets
+template<class T> inline size_t ByteSize(const RawVector<T>& v) { return v.capacity() * sizeof(T); }
+// Abc::TypedArraySamplePtr
+template<class T> inline size_t ByteSize(const std::shared_ptr<T>& sp) { return sp ? sp->size() * sizeof(typename T::value_type) : 0; }
+// AbcGeom::ITypedGeomParam<>::Sample
+template<class T> inline auto ByteSize(const T& sample) -> decltype(sample.getVals(), size_t())
+{
+    return ByteSize(sample.getVals()) + ByteSize(sample.getIndices());
+}
+
 template<class AbcPropertyType, class Body>
 inline void abcEachSamples(AbcPropertyType& prop, const Body &body);
 
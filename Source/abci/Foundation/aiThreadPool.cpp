@@ -0,0 +1,380 @@
+#include "pch.h"
+#include "aiThreadPool.h"
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+
+aiWorkStealingDeque::Buffer::Buffer(int64_t c)
+    : capacity(c), data(new std::atomic<Task*>[c])
+{
+}
+
+aiWorkStealingDeque::Buffer* aiWorkStealingDeque::Buffer::grow(int64_t top, int64_t bottom) const
+{
+    auto *ret = new Buffer(capacity * 2);
+    for (int64_t i = top; i < bottom; ++i)
+        ret->put(i, get(i));
+    return ret;
+}
+
+aiWorkStealingDeque::aiWorkStealingDeque()
+{
+    m_retired.emplace_back(new Buffer(256));
+    m_buffer = m_retired.back().get();
+}
+
+aiWorkStealingDeque::~aiWorkStealingDeque()
+{
+}
+
+void aiWorkStealingDeque::push(Task *task)
+{
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    int64_t t = m_top.load(std::memory_order_acquire);
+    Buffer *buf = m_buffer.load(std::memory_order_relaxed);
+    if (b - t > buf->capacity - 1)
+    {
+        buf = buf->grow(t, b);
+        m_retired.emplace_back(buf);
+        m_buffer.store(buf, std::memory_order_release);
+    }
+    buf->put(b, task);
+    m_bottom.store(b + 1, std::memory_order_release);
+}
+
+aiWorkStealingDeque::Task* aiWorkStealingDeque::pop()
+{
+    int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    Buffer *buf = m_buffer.load(std::memory_order_relaxed);
+    m_bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = m_top.load(std::memory_order_seq_cst);
+
+    Task *ret = nullptr;
+    if (t <= b)
+    {
+        ret = buf->get(b);
+        if (t == b)
+        {
+            // last element. race against thieves
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                ret = nullptr;
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+    }
+    else
+    {
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+aiWorkStealingDeque::Task* aiWorkStealingDeque::steal()
+{
+    int64_t t = m_top.load(std::memory_order_seq_cst);
+    int64_t b = m_bottom.load(std::memory_order_seq_cst);
+
+    Task *ret = nullptr;
+    if (t < b)
+    {
+        Buffer *buf = m_buffer.load(std::memory_order_acquire);
+        ret = buf->get(t);
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            ret = nullptr;
+    }
+    return ret;
+}
+
+bool aiWorkStealingDeque::empty() const
+{
+    return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+}
+
+
+// index of the pool worker running on the current thread. -1 if the thread is not a worker.
+static thread_local int g_worker_index = -1;
+
+aiThreadPool& aiThreadPool::instance()
+{
+    static aiThreadPool s_instance;
+    return s_instance;
+}
+
+aiThreadPool::aiThreadPool()
+{
+    startWorkers();
+}
+
+aiThreadPool::~aiThreadPool()
+{
+    stopWorkers();
+}
+
+bool aiThreadPool::setup(int worker_count, bool pin_workers)
+{
+    // keep other threads out of m_workers while it is rebuilt
+    bool expected = false;
+    if (!m_reconfiguring.compare_exchange_strong(expected, true))
+        return false;
+    while (m_num_users > 0)
+        std::this_thread::yield();
+
+    bool idle = m_num_active == 0;
+    if (idle)
+    {
+        stopWorkers();
+        m_worker_count = worker_count;
+        m_pin_workers = pin_workers;
+        startWorkers();
+    }
+    m_reconfiguring = false;
+    return idle;
+}
+
+int aiThreadPool::getWorkerCount() const
+{
+    return m_num_workers;
+}
+
+void aiThreadPool::startWorkers()
+{
+    // the thread that waits for a task group also runs tasks, so leave one hardware thread for it by default
+    int num_cores = std::max((int)std::thread::hardware_concurrency(), 1);
+    int num_workers = m_worker_count > 0 ? m_worker_count : std::max(num_cores - 1, 1);
+
+    m_stop = false;
+    for (int i = 0; i < num_workers; ++i)
+        m_workers.emplace_back(new Worker());
+    m_num_workers = num_workers;
+    for (int i = 0; i < num_workers; ++i)
+    {
+        auto& thread = m_workers[i]->thread;
+        thread = std::thread([this, i]() { process(i); });
+
+        if (m_pin_workers)
+        {
+            int core = i % num_cores;
+#if defined(_WIN32)
+            ::SetThreadAffinityMask((HANDLE)thread.native_handle(), (DWORD_PTR)1 << core);
+#elif defined(__linux__)
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(core, &cpus);
+            pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpus);
+#else
+            (void)core; // no thread affinity API on this platform
+#endif
+        }
+    }
+}
+
+void aiThreadPool::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (auto& w : m_workers)
+        w->thread.join();
+    m_workers.clear();
+    m_num_workers = 0;
+}
+
+bool aiThreadPool::enter()
+{
+    ++m_num_users;
+    if (m_reconfiguring)
+    {
+        --m_num_users;
+        return false;
+    }
+    return true;
+}
+
+void aiThreadPool::leave()
+{
+    --m_num_users;
+}
+
+void aiThreadPool::enqueue(aiTaskGroup *group, std::function<void()>&& body)
+{
+    while (!enter())
+        std::this_thread::yield();
+
+    if (group)
+        ++group->m_active;
+    ++m_num_active;
+
+    auto *task = new Task{ std::move(body), group };
+    int wi = g_worker_index;
+    if (wi >= 0 && wi < (int)m_workers.size())
+    {
+        m_workers[wi]->queue.push(task);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_injection_mutex);
+        m_injection.push_back(task);
+    }
+
+    ++m_num_pending;
+    {
+        // workers test m_num_pending while holding m_mutex. locking it here prevents lost wakeups.
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_cond.notify_one();
+    leave();
+}
+
+aiThreadPool::Task* aiThreadPool::take(int wi)
+{
+    Task *ret = nullptr;
+    int num_workers = (int)m_workers.size();
+    if (wi >= 0 && wi < num_workers)
+        ret = m_workers[wi]->queue.pop();
+
+    if (!ret)
+    {
+        std::lock_guard<std::mutex> lock(m_injection_mutex);
+        if (!m_injection.empty())
+        {
+            ret = m_injection.front();
+            m_injection.pop_front();
+        }
+    }
+
+    if (!ret)
+    {
+        // steal. start from the next worker so that thieves spread over victims
+        for (int i = 1; i <= num_workers && !ret; ++i)
+        {
+            int vi = (std::max(wi, 0) + i) % num_workers;
+            if (vi != wi)
+                ret = m_workers[vi]->queue.steal();
+        }
+    }
+
+    if (ret)
+        --m_num_pending;
+    return ret;
+}
+
+bool aiThreadPool::processOne()
+{
+    if (!enter())
+        return false;
+    auto *task = take(g_worker_index);
+    leave();
+    if (!task)
+        return false;
+    run(task);
+    return true;
+}
+
+void aiThreadPool::process(int wi)
+{
+    g_worker_index = wi;
+    for (;;)
+    {
+        auto *task = take(wi);
+        if (task)
+        {
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stop && m_num_pending == 0)
+            break;
+        m_cond.wait(lock, [this]() { return m_stop || m_num_pending > 0; });
+        if (m_stop && m_num_pending == 0)
+            break;
+    }
+    g_worker_index = -1;
+}
+
+void aiThreadPool::run(Task *task)
+{
+    task->body();
+    auto *group = task->group;
+    delete task;
+    if (group)
+        --group->m_active;
+    --m_num_active;
+}
+
+
+aiTaskGroup::~aiTaskGroup()
+{
+    wait();
+}
+
+void aiTaskGroup::run(std::function<void()>&& task)
+{
+    aiThreadPool::instance().enqueue(this, std::move(task));
+}
+
+void aiTaskGroup::wait()
+{
+    auto& pool = aiThreadPool::instance();
+    while (m_active > 0)
+    {
+        if (!pool.processOne())
+            std::this_thread::yield();
+    }
+}
+
+
+void aiWorkRange::set(uint32_t begin, uint32_t end)
+{
+    m_range = pack(begin, end);
+}
+
+bool aiWorkRange::popFront(uint32_t& index)
+{
+    uint64_t v = m_range;
+    for (;;)
+    {
+        uint32_t begin = beginOf(v), end = endOf(v);
+        if (begin >= end)
+            return false;
+        if (m_range.compare_exchange_weak(v, pack(begin + 1, end)))
+        {
+            index = begin;
+            return true;
+        }
+    }
+}
+
+bool aiWorkRange::stealBack(uint32_t& begin, uint32_t& end)
+{
+    uint64_t v = m_range;
+    for (;;)
+    {
+        uint32_t b = beginOf(v), e = endOf(v);
+        if (b >= e)
+            return false;
+        uint32_t mid = b + (e - b) / 2;
+        if (m_range.compare_exchange_weak(v, pack(b, mid)))
+        {
+            begin = mid;
+            end = e;
+            return true;
+        }
+    }
+}
+
+uint32_t aiWorkRange::size() const
+{
+    uint64_t v = m_range;
+    uint32_t begin = beginOf(v), end = endOf(v);
+    return begin < end ? end - begin : 0;
+}
+
+int aiResolveWorkerCount(int n)
+{
+    int max_workers = aiThreadPool::instance().getWorkerCount() + 1;
+    return n <= 0 ? max_workers : std::min(n, max_workers);
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <atomic>
+
+class aiTaskGroup;
+
+struct aiThreadPoolTask
+{
+    std::function<void()> body;
+    aiTaskGroup *group; // can be null
+};
+
+// Chase-Lev work stealing deque.
+// only the owner thread calls push() and pop() (LIFO end), any thread can call steal() (FIFO end).
+class aiWorkStealingDeque
+{
+public:
+    using Task = aiThreadPoolTask;
+
+    aiWorkStealingDeque();
+    ~aiWorkStealingDeque();
+    void push(Task *task);
+    Task* pop();
+    Task* steal();
+    bool empty() const;
+
+private:
+    struct Buffer
+    {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<Task*>[]> data;
+
+        explicit Buffer(int64_t c);
+        Task* get(int64_t i) const { return data[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, Task *t) { data[i & (capacity - 1)].store(t, std::memory_order_relaxed); }
+        Buffer* grow(int64_t top, int64_t bottom) const;
+    };
+
+    std::atomic<int64_t> m_top{ 0 };
+    std::atomic<int64_t> m_bottom{ 0 };
+    std::atomic<Buffer*> m_buffer;
+    // buffers replaced by grow() can still be read by thieves, so they are kept until the deque dies
+    std::vector<std::unique_ptr<Buffer>> m_retired;
+};
+
+
+// persistent worker threads shared by all contexts.
+// each worker owns a work stealing deque. tasks pushed from a worker go to its own deque, tasks pushed from other
+// threads go to a shared injection queue. idle workers steal from the injection queue and from each other.
+class aiThreadPool
+{
+public:
+    using Task = aiThreadPoolTask;
+
+    static aiThreadPool& instance();
+
+    // restart workers with new settings. returns false and keeps the current workers if any task is queued or running.
+    // worker_count <= 0: hardware threads - 1. pin_workers: bind worker i to logical processor i.
+    bool setup(int worker_count, bool pin_workers);
+    int getWorkerCount() const;
+
+    // group can be null
+    void enqueue(aiTaskGroup *group, std::function<void()>&& task);
+    // run one queued task on the calling thread. returns false if there is nothing to run.
+    bool processOne();
+
+private:
+    struct Worker
+    {
+        aiWorkStealingDeque queue;
+        std::thread thread;
+    };
+
+    aiThreadPool();
+    ~aiThreadPool();
+    void startWorkers();
+    void stopWorkers();
+    void process(int wi);
+    Task* take(int wi);
+    void run(Task *task);
+    bool enter();
+    void leave();
+
+    int m_worker_count = 0;
+    bool m_pin_workers = false;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<int> m_num_workers{ 0 }; // m_workers.size() for threads outside the pool
+
+    std::deque<Task*> m_injection;
+    std::mutex m_injection_mutex;
+
+    std::atomic<int> m_num_pending{ 0 };
+    std::atomic<int> m_num_active{ 0 }; // tasks queued or running
+    // threads inside enqueue() / processOne(). setup() waits for them to leave before it touches m_workers
+    std::atomic<int> m_num_users{ 0 };
+    std::atomic<bool> m_reconfiguring{ false };
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop = false;
+};
+
+
+// set of tasks that can be waited together.
+// wait() executes queued tasks on the calling thread instead of blocking, so it can be nested in tasks.
+class aiTaskGroup
+{
+public:
+    ~aiTaskGroup();
+    void run(std::function<void()>&& task);
+    void wait();
+
+private:
+    friend class aiThreadPool;
+    std::atomic<int> m_active{ 0 };
+};
+
+
+// range of indices that one worker consumes from the front while others steal from the back.
+// begin and end are packed into one 64 bit word so that both sides can update it with a single CAS.
+class aiWorkRange
+{
+public:
+    void set(uint32_t begin, uint32_t end);
+    bool popFront(uint32_t& index);
+    bool stealBack(uint32_t& begin, uint32_t& end);
+    uint32_t size() const;
+
+private:
+    static uint64_t pack(uint32_t begin, uint32_t end) { return ((uint64_t)begin << 32) | end; }
+    static uint32_t beginOf(uint64_t v) { return (uint32_t)(v >> 32); }
+    static uint32_t endOf(uint64_t v) { return (uint32_t)v; }
+
+    std::atomic<uint64_t> m_range{ 0 };
+};
+
+// number of workers including the calling thread. n <= 0 means all workers of the pool.
+int aiResolveWorkerCount(int n);
+
+// call body(i) for each i in [0, num).
+// the range is split into num_workers contiguous partitions. each partition is processed in order by one worker,
+// and a worker that runs out of work steals the back half of the largest remaining partition.
+template<class Body>
+inline void aiParallelFor(int num, int num_workers, const Body& body)
+{
+    num_workers = std::min(aiResolveWorkerCount(num_workers), num);
+    if (num_workers <= 1)
+    {
+        for (int i = 0; i < num; ++i)
+            body(i);
+        return;
+    }
+
+    std::unique_ptr<aiWorkRange[]> ranges(new aiWorkRange[num_workers]);
+    for (int wi = 0; wi < num_workers; ++wi)
+        ranges[wi].set((uint32_t)((int64_t)num * wi / num_workers), (uint32_t)((int64_t)num * (wi + 1) / num_workers));
+
+    auto worker = [&](int wi) {
+        auto& own = ranges[wi];
+        for (;;)
+        {
+            uint32_t i;
+            while (own.popFront(i))
+                body((int)i);
+
+            // find the victim with the most remaining work
+            int victim = -1;
+            uint32_t victim_size = 0;
+            for (int vi = 0; vi < num_workers; ++vi)
+            {
+                uint32_t s = ranges[vi].size();
+                if (vi != wi && s > victim_size)
+                {
+                    victim = vi;
+                    victim_size = s;
+                }
+            }
+
+            uint32_t begin, end;
+            if (victim < 0 || !ranges[victim].stealBack(begin, end))
+            {
+                if (victim < 0)
+                    break;
+                continue;
+            }
+            own.set(begin, end);
+        }
+    };
+
+    aiTaskGroup group;
+    for (int wi = 1; wi < num_workers; ++wi)
+        group.run([&worker, wi]() { worker(wi); });
+    worker(0);
+    group.wait();
+}
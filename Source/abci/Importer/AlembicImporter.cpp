@@ -8,6 +8,7 @@
 #include "aiCamera.h"
 #include "aiPoints.h"
 #include "aiProperty.h"
+#include "../Foundation/aiThreadPool.h"
 
 abciAPI abcSampleSelector aiTimeToSampleSelector(double time)
 {
@@ -28,6 +29,11 @@ abciAPI void aiClearContextsWithPath(const char *path)
     aiContextManager::destroyContextsWithPath(path);
 }
 
+abciAPI bool aiSetThreadPoolConfig(const aiThreadPoolConfig *conf)
+{
+    return conf && aiThreadPool::instance().setup(conf->worker_count, conf->pin_workers);
+}
+
 abciAPI aiContext* aiContextCreate(int uid)
 {
     return aiContextManager::getContext(uid);
@@ -76,12 +82,23 @@ abciAPI aiObject* aiContextGetTopObject(aiContext* ctx)
     return ctx ? ctx->getTopObject() : 0;
 }
 
+abciAPI aiObject* aiContextFindObject(aiContext* ctx, const char *path)
+{
+    return ctx ? ctx->findObject(path) : nullptr;
+}
+
 abciAPI void aiContextUpdateSamples(aiContext* ctx, double time)
 {
     if (ctx)
         ctx->updateSamples(time);
 }
 
+abciAPI void aiContextGetSampleCacheStats(aiContext* ctx, aiSampleCacheStats *dst)
+{
+    if (ctx && dst)
+        ctx->getSampleCache().getStats(*dst);
+}
+
 abciAPI int aiTimeSamplingGetSampleCount(aiTimeSampling *self)
 {
     return self ? (int)self->getSampleCount() : 0;
@@ -162,6 +179,8 @@ abciAPI aiSample* aiSchemaGetSample(aiSchema * schema)
 abciAPI void aiSchemaUpdateSample(aiSchema* schema, const abcSampleSelector *ss)
 {
     if (schema) {
+        // prefetch tasks of the context may be using the schema's prefetch slots
+        schema->getContext()->waitPrefetch();
         schema->markForceUpdate();
         schema->updateSample(*ss);
     }
@@ -230,12 +249,63 @@ abciAPI void aiPolyMeshGetSubmeshSummaries(aiPolyMeshSample* sample, aiSubmeshSu
         sample->getSubmeshSummaries(dst);
 }
 
+abciAPI void aiPolyMeshGetSplitDirtySummaries(aiPolyMeshSample* sample, aiMeshSplitDirtySummary* dst)
+{
+    if (sample && dst)
+        sample->getSplitDirtySummaries(dst);
+}
+
 abciAPI void aiPolyMeshFillVertexBuffer(aiPolyMeshSample* sample, aiPolyMeshData* vbs, aiSubmeshData* ibs)
 {
     if (sample)
         sample->fillVertexBuffer(vbs, ibs);
 }
 
+abciAPI void aiPolyMeshFillSplitStream(aiPolyMeshSample* sample, int split_index, aiVertexStreamData* dst)
+{
+    if (sample && dst)
+        sample->fillSplitStream(split_index, *dst);
+}
+
+abciAPI aiAsyncTask* aiPolyMeshFillVertexBufferAsync(aiPolyMeshSample* sample, aiPolyMeshData* vbs, aiSubmeshData* ibs)
+{
+    return sample ? sample->fillVertexBufferAsync(vbs, ibs) : nullptr;
+}
+
+abciAPI bool aiAsyncTaskIsCompleted(aiAsyncTask* task)
+{
+    return task ? task->isCompleted() : true;
+}
+
+abciAPI void aiAsyncTaskWait(aiAsyncTask* task)
+{
+    if (task)
+        task->wait();
+}
+
+abciAPI aiPolyMeshSample* aiPolyMeshPinSample(aiPolyMesh* schema)
+{
+    return schema ? schema->pinSample() : nullptr;
+}
+
+abciAPI void aiPolyMeshReleaseSample(aiPolyMesh* schema, aiPolyMeshSample* sample)
+{
+    if (schema && sample)
+        schema->releaseSample(sample);
+}
+
+abciAPI void aiPolyMeshGetSplitView(aiPolyMeshSample* sample, int split_index, aiPolyMeshSplitView* dst)
+{
+    if (sample && dst)
+        sample->getSplitView(split_index, *dst);
+}
+
+abciAPI void aiPolyMeshGetSubmeshView(aiPolyMeshSample* sample, int submesh_index, aiBufferView* dst)
+{
+    if (sample && dst)
+        sample->getSubmeshView(submesh_index, *dst);
+}
+
 abciAPI void aiCameraGetData(aiCameraSample* sample, CameraData *dst)
 {
     if (sample)
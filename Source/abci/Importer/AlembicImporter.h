@@ -7,6 +7,7 @@
 class aiContext;
 class aiTimeSampling;
 class aiObject;
+class aiAsyncTask;
 #ifdef abciImpl
 class aiSchema;             // : aiObject
 class aiSample;
@@ -44,6 +45,19 @@ enum class TangentsMode
     Compute,
 };
 
+enum class aiBoundsMode
+{
+    ComputeOnFill, // MinMax of each split when vertex buffers are filled
+    ComputeOnCook, // MinMax of all splits in parallel while cooking. kept while the sample's points are the same
+    ArchiveIfPossible, // self bounds of the archive for single split meshes without interpolation. ComputeOnCook otherwise
+};
+
+enum class aiIndexFormat
+{
+    UInt32,
+    UInt16IfPossible, // uint16 indices for submeshes of splits with up to 0xffff vertices
+};
+
 enum class aiTimeSamplingType
 {
     Uniform,
@@ -97,20 +111,63 @@ enum class aiPropertyType
     ArrayTypeEnd     = Float4x4Array,
 };
 
+enum class aiAttributeFormat
+{
+    Float32,
+    Oct16,  // normals and tangents. 2 snorm16 octahedral. tangents add w as snorm16 and a padding snorm16
+    Half16, // uv
+    UNorm8, // colors. 4 unorm8, alpha is 1 for rgb
+};
+
+// formats the cook stage converts attributes to. the matching aiPolyMeshData buffers receive encoded elements.
+// formats an attribute doesn't support are treated as Float32
+struct aiVertexFormat
+{
+    aiAttributeFormat normals = aiAttributeFormat::Float32;
+    aiAttributeFormat tangents = aiAttributeFormat::Float32;
+    aiAttributeFormat uv = aiAttributeFormat::Float32; // uv0 and uv1
+    aiAttributeFormat colors = aiAttributeFormat::Float32; // rgba and rgb
+};
+
 struct aiConfig
 {
     NormalsMode normals_mode = NormalsMode::ComputeIfMissing;
     TangentsMode tangents_mode = TangentsMode::None;
+    aiBoundsMode bounds_mode = aiBoundsMode::ComputeOnCook;
     float scale_factor = 1.0f;
     float aspect_ratio = -1.0f;
     float vertex_motion_scale = 1.0f;
     int split_unit = 0x7fffffff;
+    int worker_count = 1; // threads aiContextUpdateSamples() spreads nodes over. 1: serial, 0 or less: all available
+    int prefetch_count = 0; // upcoming samples each mesh / points reads and cooks in the background. 0: disabled
+    uint64_t sample_cache_budget = 0; // bytes of cooked mesh / points samples kept for revisits. 0: disabled
+    int stream_count = 1; // file streams opened on load. concurrent reads need one each. 0 or less: one per worker
     bool swap_handedness = true;
     bool swap_face_winding = false;
     bool interpolate_samples = true;
     bool import_point_polygon = true;
     bool import_line_polygon = true;
     bool import_triangle_polygon = true;
+    bool lazy_hierarchy = false; // create child objects on first access instead of at load
+    bool hash_vertex_dedup = false; // merge all vertices with identical attributes, not only ones sharing the last emitted vertex
+    aiIndexFormat index_format = aiIndexFormat::UInt32;
+    aiVertexFormat vertex_format;
+    bool dirty_ranges = false; // narrow aiMeshSplitDirtySummary to changed vertices. keeps a copy of the last update to compare
+    bool map_archives = false; // read Ogawa archives through a memory mapping (linux). the file must not be truncated while loaded
+};
+
+struct aiThreadPoolConfig
+{
+    int worker_count = 0; // 0 or less: hardware threads - 1
+    bool pin_workers = false; // bind worker i to logical processor i
+};
+
+struct aiSampleCacheStats
+{
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint64_t byte_size = 0;
+    int entry_count = 0;
 };
 
 struct aiXformData
@@ -156,6 +213,15 @@ struct aiMeshSampleSummary
     int vertex_count = 0;
     int index_count = 0;
     bool topology_changed = false;
+    // attribute data is the same as the previous update. uploads of these can be skipped
+    bool unchanged_points = false;
+    bool unchanged_velocities = false;
+    bool unchanged_normals = false;
+    bool unchanged_tangents = false;
+    bool unchanged_uv0 = false;
+    bool unchanged_uv1 = false;
+    bool unchanged_rgba = false;
+    bool unchanged_rgb = false;
 };
 
 struct aiMeshSplitSummary
@@ -168,24 +234,49 @@ struct aiMeshSplitSummary
     int index_offset = 0;
 };
 
+// vertices relative to the first vertex of the split. empty if begin >= end
+struct aiVertexRange
+{
+    int begin = 0;
+    int end = 0;
+};
+
+// attributes of a split that changed since the last fill. an attribute is dirty if its range is not empty.
+// ranges cover the whole split unless aiConfig::dirty_ranges is enabled
+struct aiMeshSplitDirtySummary
+{
+    aiVertexRange points;
+    aiVertexRange velocities;
+    aiVertexRange normals;
+    aiVertexRange tangents;
+    aiVertexRange uv0;
+    aiVertexRange uv1;
+    aiVertexRange rgba;
+    aiVertexRange rgb;
+};
+
 struct aiSubmeshSummary
 {
     int split_index = 0;
     int submesh_index = 0; // submesh index in split
     int index_count = 0;
     aiTopology topology = aiTopology::Triangles;
+    int index_size = 4; // bytes per index aiSubmeshData::indices receives. 2 or 4
 };
 
+// the types of normals, tangents, uv and colors are those of aiAttributeFormat::Float32. with another
+// aiConfig::vertex_format the same pointers receive the encoded elements described at aiAttributeFormat instead
+// (2 x int16 normals, 4 x int16 tangents, 2 x half uv, 4 x uint8 colors) and must point to buffers of that type.
 struct aiPolyMeshData
 {
     abcV3 *points = nullptr;
     abcV3 *velocities = nullptr;
-    abcV3 *normals = nullptr;
-    abcV4 *tangents = nullptr;
-    abcV2 *uv0 = nullptr;
-    abcV2 *uv1 = nullptr;
-    abcV4 *rgba = nullptr;
-    abcV4 *rgb = nullptr;
+    abcV3 *normals = nullptr; // 2 x int16 if vertex_format.normals is Oct16
+    abcV4 *tangents = nullptr; // 4 x int16 if vertex_format.tangents is Oct16
+    abcV2 *uv0 = nullptr; // 2 x half if vertex_format.uv is Half16
+    abcV2 *uv1 = nullptr; // 2 x half if vertex_format.uv is Half16
+    abcV4 *rgba = nullptr; // 4 x uint8 if vertex_format.colors is UNorm8
+    abcV4 *rgb = nullptr; // 4 x uint8 if vertex_format.colors is UNorm8
     int *indices = nullptr;
 
     int vertex_count = 0;
@@ -195,9 +286,63 @@ struct aiPolyMeshData
     abcV3 extents = { 0.0f, 0.0f, 0.0f };
 };
 
+enum class aiVertexAttribute
+{
+    Points,
+    Velocities,
+    Normals,
+    Tangents,
+    UV0,
+    UV1,
+    RGBA,
+    RGB, // written as 4 components, like aiPolyMeshData::rgb
+};
+
+// one attribute of an interleaved vertex stream
+struct aiVertexElement
+{
+    aiVertexAttribute attribute = aiVertexAttribute::Points;
+    aiAttributeFormat format = aiAttributeFormat::Float32;
+    int offset = 0; // bytes from aiVertexStreamData::data to the first vertex's element
+    int stride = 0; // bytes between vertices
+};
+
+struct aiVertexStreamData
+{
+    void *data = nullptr;
+    const aiVertexElement *elements = nullptr;
+    int element_count = 0;
+
+    abcV3 center = { 0.0f, 0.0f, 0.0f };
+    abcV3 extents = { 0.0f, 0.0f, 0.0f };
+};
+
 struct aiSubmeshData
 {
-    int *indices = nullptr;
+    void *indices = nullptr; // int or uint16_t. see aiSubmeshSummary::index_size
+};
+
+// read-only cooked data of a pinned sample. see aiPolyMeshPinSample()
+struct aiBufferView
+{
+    const void *data = nullptr; // null if the sample doesn't have the attribute
+    int count = 0;
+    int element_size = 0; // bytes per element. depends on aiConfig::vertex_format
+};
+
+struct aiPolyMeshSplitView
+{
+    aiBufferView points;
+    aiBufferView velocities;
+    aiBufferView normals;
+    aiBufferView tangents;
+    aiBufferView uv0;
+    aiBufferView uv1;
+    aiBufferView rgba;
+    aiBufferView rgb; // 3 floats unless encoded. not widened like aiPolyMeshData::rgb
+
+    abcV3 center = { 0.0f, 0.0f, 0.0f };
+    abcV3 extents = { 0.0f, 0.0f, 0.0f };
 };
 
 struct aiPointsSummary
@@ -243,6 +388,7 @@ abciAPI abcSampleSelector aiTimeToSampleSelector(double time);
 abciAPI abcSampleSelector aiIndexToSampleSelector(int64_t index);
 abciAPI void            aiCleanup();
 abciAPI void            aiClearContextsWithPath(const char *path);
+abciAPI bool            aiSetThreadPoolConfig(const aiThreadPoolConfig *conf); // false while tasks are in flight
 
 abciAPI aiContext*      aiContextCreate(int uid);
 abciAPI void            aiContextDestroy(aiContext* ctx);
@@ -253,7 +399,9 @@ abciAPI int             aiContextGetTimeSamplingCount(aiContext* ctx);
 abciAPI aiTimeSampling* aiContextGetTimeSampling(aiContext* ctx, int i);
 abciAPI void            aiContextGetTimeRange(aiContext* ctx, double *begin, double *end);
 abciAPI aiObject*       aiContextGetTopObject(aiContext* ctx);
+abciAPI aiObject*       aiContextFindObject(aiContext* ctx, const char *path);
 abciAPI void            aiContextUpdateSamples(aiContext* ctx, double time);
+abciAPI void            aiContextGetSampleCacheStats(aiContext* ctx, aiSampleCacheStats *dst);
 
 abciAPI int             aiTimeSamplingGetSampleCount(aiTimeSampling *self);
 abciAPI double          aiTimeSamplingGetTime(aiTimeSampling *self, int index);
@@ -286,7 +434,18 @@ abciAPI void            aiPolyMeshGetSummary(aiPolyMesh* schema, aiMeshSummary*
 abciAPI void            aiPolyMeshGetSampleSummary(aiPolyMeshSample* sample, aiMeshSampleSummary* dst);
 abciAPI void            aiPolyMeshGetSplitSummaries(aiPolyMeshSample* sample, aiMeshSplitSummary *dst);
 abciAPI void            aiPolyMeshGetSubmeshSummaries(aiPolyMeshSample* sample, aiSubmeshSummary* dst);
+abciAPI void            aiPolyMeshGetSplitDirtySummaries(aiPolyMeshSample* sample, aiMeshSplitDirtySummary* dst);
 abciAPI void            aiPolyMeshFillVertexBuffer(aiPolyMeshSample* sample, aiPolyMeshData* vbs, aiSubmeshData* ibs);
+abciAPI void            aiPolyMeshFillSplitStream(aiPolyMeshSample* sample, int split_index, aiVertexStreamData* dst);
+// vbs and ibs must stay valid until the task is completed. the task is owned by the sample
+abciAPI aiAsyncTask*    aiPolyMeshFillVertexBufferAsync(aiPolyMeshSample* sample, aiPolyMeshData* vbs, aiSubmeshData* ibs);
+abciAPI bool            aiAsyncTaskIsCompleted(aiAsyncTask* task);
+abciAPI void            aiAsyncTaskWait(aiAsyncTask* task);
+// views of a pinned sample stay valid until it is released. release every pin before the context is destroyed
+abciAPI aiPolyMeshSample* aiPolyMeshPinSample(aiPolyMesh* schema);
+abciAPI void            aiPolyMeshReleaseSample(aiPolyMesh* schema, aiPolyMeshSample* sample);
+abciAPI void            aiPolyMeshGetSplitView(aiPolyMeshSample* sample, int split_index, aiPolyMeshSplitView* dst);
+abciAPI void            aiPolyMeshGetSubmeshView(aiPolyMeshSample* sample, int submesh_index, aiBufferView* dst);
 
 abciAPI void            aiCameraGetData(aiCameraSample* sample, CameraData *dst);
 
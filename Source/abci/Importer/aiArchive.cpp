@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "aiInternal.h"
+#include "aiArchive.h"
+#include "../Foundation/aiMappedStream.h"
+#include <istream>
+#ifdef WIN32
+    #include <windows.h>
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+#ifdef WIN32
+class lockFreeIStream : public std::ifstream
+{
+private:
+    HANDLE _handle;
+
+    FILE *Init(const wchar_t *name)
+    {
+        _handle = CreateFileW(name,
+            GENERIC_READ,
+            FILE_SHARE_DELETE | FILE_SHARE_READ | FILE_SHARE_WRITE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL);
+        if (_handle == INVALID_HANDLE_VALUE)
+        {
+            auto errorMsg = GetLastErrorAsString();
+            std::cerr << "Alembic cannot open:" << name << ":" << errorMsg << std::endl;
+            return nullptr;
+        }
+
+        int nHandle = _open_osfhandle((long)_handle, _O_RDONLY);
+
+        if (nHandle == -1)
+        {
+            ::CloseHandle(_handle);
+            return nullptr;
+        }
+
+        auto fh = _fdopen(nHandle, "rb");
+        if (!fh)
+        {
+            ::CloseHandle(_handle);
+        }
+
+        return fh;
+    }
+
+public:
+    lockFreeIStream(const wchar_t  *name) : std::ifstream(Init(name)) // Beware of constructors, initializers: Init changes the state of the class itself
+    {}
+    ~lockFreeIStream()
+    {
+        if (_handle != INVALID_HANDLE_VALUE)
+        {
+            auto errorMsg = GetLastErrorAsString();
+            std::cerr << "Alembic cannot close HANDLE:" << errorMsg << std::endl;
+            ::CloseHandle(_handle);
+        }
+    }
+
+private:
+    std::string GetLastErrorAsString()
+    {
+        DWORD errorMessageID = ::GetLastError();
+        if (errorMessageID == 0)
+            return std::string();
+
+        LPSTR messageBuffer = nullptr;
+        size_t size =
+            FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                NULL,
+                errorMessageID,
+                MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                (LPSTR)&messageBuffer,
+                0,
+                NULL);
+
+        std::string message(messageBuffer, size);
+        LocalFree(messageBuffer);
+
+        return message;
+    }
+};
+#endif
+
+// archives by normalized path and the settings they were opened with. entries expire when the last context that
+// loaded them is gone. an entry that is being opened holds the future of the opener, so others wait for it instead of
+// opening the file again, and the global lock is only held to look up entries.
+struct aiArchiveEntry
+{
+    std::weak_ptr<aiArchive> archive;
+    std::shared_ptr<std::promise<aiArchivePtr>> opener;
+    std::shared_future<aiArchivePtr> opening;
+};
+using aiArchiveKey = std::tuple<std::string, int, bool>;
+static std::map<aiArchiveKey, aiArchiveEntry> g_archives;
+static std::mutex g_archives_mutex;
+
+std::shared_ptr<aiArchive> aiArchive::open(const std::string& path, const char *in_path, const std::wstring& wpath, int num_streams, bool map_file)
+{
+    auto key = aiArchiveKey(path, num_streams, map_file);
+    std::shared_ptr<std::promise<aiArchivePtr>> opener;
+    std::shared_future<aiArchivePtr> opening;
+    {
+        std::lock_guard<std::mutex> lock(g_archives_mutex);
+        auto& entry = g_archives[key];
+        if (auto ret = entry.archive.lock())
+        {
+            DebugLogW(L"Archive '%s' already opened", wpath.c_str());
+            return ret;
+        }
+        if (!entry.opener)
+        {
+            entry.opener = std::make_shared<std::promise<aiArchivePtr>>();
+            entry.opening = entry.opener->get_future().share();
+            opener = entry.opener;
+        }
+        opening = entry.opening;
+    }
+
+    // another context is opening the same file
+    if (!opener)
+    {
+        auto ret = opening.get();
+        if (ret)
+            DebugLogW(L"Archive '%s' already opened", wpath.c_str());
+        return ret;
+    }
+
+    std::shared_ptr<aiArchive> ret(new aiArchive(path));
+    if (!ret->openOgawa(in_path, wpath, num_streams, map_file) && !ret->openHDF5())
+        ret.reset();
+
+    {
+        // forget() may have dropped the entry meanwhile. a new one belongs to a later open
+        std::lock_guard<std::mutex> lock(g_archives_mutex);
+        auto it = g_archives.find(key);
+        if (it != g_archives.end() && it->second.opener == opener)
+        {
+            if (ret)
+            {
+                it->second.archive = ret;
+                it->second.opener.reset();
+                it->second.opening = std::shared_future<aiArchivePtr>();
+            }
+            else
+            {
+                g_archives.erase(it);
+            }
+        }
+    }
+    opener->set_value(ret);
+    return ret;
+}
+
+void aiArchive::forget(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(g_archives_mutex);
+    auto it = g_archives.lower_bound(aiArchiveKey(path, std::numeric_limits<int>::min(), false));
+    while (it != g_archives.end() && std::get<0>(it->first) == path)
+        it = g_archives.erase(it);
+}
+
+aiArchive::aiArchive(const std::string& path)
+    : m_path(path)
+{
+}
+
+aiArchive::~aiArchive()
+{
+    m_shared.clear();
+    m_archive.reset();
+    closeStreams();
+}
+
+bool aiArchive::openOgawa(const char *in_path, const std::wstring& wpath, int num_streams, bool map_file)
+{
+    try
+    {
+        // Abc::IArchive doesn't accept wide string path. so create file stream with wide string path and pass it.
+        // (VisualC++'s std::ifstream accepts wide string)
+        // Ogawa hands each read a stream that no other thread is using, so reads from different objects only
+        // overlap when there are multiple streams.
+#ifdef __linux__
+        // all streams read one mapping when asked to. falls back to file streams if the file can't be mapped
+        auto mapped = map_file ? aiMappedFile::open(in_path) : nullptr;
+#endif
+        for (int i = 0; i < num_streams; ++i)
+        {
+            m_streams.push_back(
+#ifdef WIN32
+                new lockFreeIStream(wpath.c_str())
+#elif __linux__
+                mapped ? (std::istream*)new aiMappedIStream(mapped) : new std::ifstream(in_path, std::ios::in | std::ios::binary)
+#else
+                new std::ifstream(m_path.c_str(), std::ios::in | std::ios::binary)
+#endif
+            );
+        }
+
+        Alembic::AbcCoreOgawa::ReadArchive archive_reader(m_streams);
+        m_archive = Abc::IArchive(archive_reader(m_path), Abc::kWrapExisting, Abc::ErrorHandler::kThrowPolicy);
+        DebugLog("Successfully opened Ogawa archive");
+        m_isHDF5 = false;
+        return true;
+    }
+    catch (Alembic::Util::Exception e)
+    {
+        // HDF5 archive doesn't accept external stream. so close it.
+        // (that means if path contains wide characters, it can't be opened. I couldn't find solution..)
+        closeStreams();
+        return false;
+    }
+}
+
+bool aiArchive::openHDF5()
+{
+    try
+    {
+        m_archive = Abc::IArchive(AbcCoreHDF5::ReadArchive(), m_path);
+        DebugLog("Successfully opened HDF5 archive");
+        m_isHDF5 = true;
+        return true;
+    }
+    catch (Alembic::Util::Exception e2)
+    {
+        DebugLog("Failed to open archive: %s", e2.what());
+        return false;
+    }
+}
+
+void aiArchive::closeStreams()
+{
+    for (auto s : m_streams)
+    {
+        delete s;
+    }
+    m_streams.clear();
+}
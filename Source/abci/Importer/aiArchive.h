@@ -0,0 +1,60 @@
+#pragma once
+
+class aiMappedFile;
+
+// opened archive shared by all contexts that load the same path with the same settings.
+// holds the file streams and the Alembic archive, plus cooked data that doesn't depend on per-context state.
+class aiArchive
+{
+public:
+    // returns the archive already opened for path with the same num_streams and map_file if any. the file is opened
+    // outside of the global lock. concurrent opens of the same archive wait for the first one
+    static std::shared_ptr<aiArchive> open(const std::string& path, const char *in_path, const std::wstring& wpath, int num_streams, bool map_file);
+    // next open() of path opens the file again. for assets that are reimported
+    static void forget(const std::string& path);
+
+    ~aiArchive();
+
+    const std::string& getPath() const { return m_path; }
+    Abc::IArchive getArchive() const { return m_archive; }
+    bool isHDF5() const { return m_isHDF5; }
+
+    // read-only data shared between contexts. the first publisher wins and entries never change after that.
+    template<class T> std::shared_ptr<T> findShared(const std::string& key);
+    // returns the entry that ended up registered for key
+    template<class T> std::shared_ptr<T> publishShared(const std::string& key, const std::shared_ptr<T>& data);
+
+private:
+    aiArchive(const std::string& path);
+    bool openOgawa(const char *in_path, const std::wstring& wpath, int num_streams, bool map_file);
+    bool openHDF5();
+    void closeStreams();
+
+    std::string m_path;
+    std::vector<std::istream*> m_streams;
+    Abc::IArchive m_archive;
+    bool m_isHDF5 = false;
+
+    std::map<std::string, std::shared_ptr<void>> m_shared;
+    std::mutex m_shared_mutex;
+};
+using aiArchivePtr = std::shared_ptr<aiArchive>;
+
+
+template<class T>
+inline std::shared_ptr<T> aiArchive::findShared(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_shared_mutex);
+    auto it = m_shared.find(key);
+    return it != m_shared.end() ? std::static_pointer_cast<T>(it->second) : nullptr;
+}
+
+template<class T>
+inline std::shared_ptr<T> aiArchive::publishShared(const std::string& key, const std::shared_ptr<T>& data)
+{
+    std::lock_guard<std::mutex> lock(m_shared_mutex);
+    auto& entry = m_shared[key];
+    if (!entry)
+        entry = data;
+    return std::static_pointer_cast<T>(entry);
+}
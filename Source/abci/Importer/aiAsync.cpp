@@ -1,13 +1,8 @@
 #include "pch.h"
 #include "aiAsync.h"
+#include "../Foundation/aiThreadPool.h"
 
 
-aiAsyncManager::~aiAsyncManager()
-{
-    if (m_future.valid())
-        m_future.wait();
-}
-
 aiAsyncManager& aiAsyncManager::instance()
 {
     static aiAsyncManager s_instance;
@@ -21,51 +16,18 @@ void aiAsyncManager::queue(aiAsync *task)
 
 void aiAsyncManager::queue(aiAsync **tasks, size_t num)
 {
+    auto& pool = aiThreadPool::instance();
     for (size_t i = 0; i < num; ++i)
-        tasks[i]->prepare();
-
-    {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_tasks.insert(m_tasks.end(), tasks, tasks + num);
-
-        // launch worker thread (task) if needed
-        if (!m_processing)
-        {
-            m_processing = true;
-            m_future = std::async(std::launch::async, [this]() { process(); });
-        }
-    }
-}
-
-void aiAsyncManager::process()
-{
-    while (true)
     {
-        aiAsync *task = nullptr;
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            if (!m_tasks.empty())
-            {
-                task = m_tasks.front();
-                m_tasks.pop_front();
-            }
-            else
-            {
-                m_processing = false;
-            }
-        }
-
-        if (task)
-            task->run();
-        else
-            break;
+        auto *task = tasks[i];
+        task->prepare();
+        pool.enqueue(nullptr, [task]() { task->run(); });
     }
 }
 
 aiAsyncLoad::~aiAsyncLoad()
 {
-    if (m_async_cook.valid())
-        m_async_cook.wait();
+    wait();
 }
 
 void aiAsyncLoad::reset()
@@ -91,7 +53,8 @@ void aiAsyncLoad::run()
 
     if (m_cook)
     {
-        m_async_cook = std::async(std::launch::async, [this]() {
+        // cook as a separate task so that this worker can go on to the next read
+        aiThreadPool::instance().enqueue(nullptr, [this]() {
             m_cook();
             release();
         });
@@ -104,18 +67,56 @@ void aiAsyncLoad::run()
 
 void aiAsyncLoad::release()
 {
-    {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_completed = true;
-    }
+    // notify while locked. wait() takes the lock before returning, so the owner can't be destroyed under notify_all()
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_completed = true;
     m_notify_completed.notify_all();
 }
 
 void aiAsyncLoad::wait()
 {
-    if (!m_completed)
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_notify_completed.wait(lock, [this] { return m_completed; });
-    }
+    // help the pool while the task is in flight. once the queues are empty, the remaining stages are
+    // in the hands of workers and blocking is safe.
+    auto& pool = aiThreadPool::instance();
+    while (!m_completed && pool.processOne())
+        ;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notify_completed.wait(lock, [this] { return m_completed.load(); });
+}
+
+
+aiAsyncTask::~aiAsyncTask()
+{
+    wait();
+}
+
+bool aiAsyncTask::isCompleted() const
+{
+    return m_completed;
+}
+
+void aiAsyncTask::prepare()
+{
+    m_completed = false;
+}
+
+void aiAsyncTask::run()
+{
+    if (m_body)
+        m_body();
+    // same as aiAsyncLoad::release(). the owner may destroy the task as soon as wait() returns
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_completed = true;
+    m_notify_completed.notify_all();
+}
+
+void aiAsyncTask::wait()
+{
+    auto& pool = aiThreadPool::instance();
+    while (!m_completed && pool.processOne())
+        ;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notify_completed.wait(lock, [this] { return m_completed.load(); });
 }
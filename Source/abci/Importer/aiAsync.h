@@ -9,21 +9,13 @@ public:
     virtual void wait() = 0;
 };
 
+// runs aiAsync tasks on aiThreadPool
 class aiAsyncManager
 {
 public:
     static aiAsyncManager& instance();
     void queue(aiAsync *task);
     void queue(aiAsync **tasks, size_t num);
-
-private:
-    ~aiAsyncManager();
-    void process();
-
-    std::deque<aiAsync*> m_tasks;
-    std::mutex m_mutex;
-    std::future<void> m_future;
-    bool m_processing = false;
 };
 
 
@@ -43,9 +35,27 @@ public:
 private:
     void release();
 
-    std::future<void> m_async_cook;
-    // these are needed because m_async_cook possibly has not started yet when wait() is called
+    // these are needed because the cook task possibly has not started yet when wait() is called
+    std::mutex m_mutex;
+    std::condition_variable m_notify_completed;
+    std::atomic<bool> m_completed{ true };
+};
+
+
+// runs a single function. the caller keeps the object until wait() returns
+class aiAsyncTask : public aiAsync
+{
+public:
+    std::function<void()> m_body;
+
+    ~aiAsyncTask();
+    bool isCompleted() const;
+    void prepare() override;
+    void run() override;
+    void wait() override;
+
+private:
     std::mutex m_mutex;
     std::condition_variable m_notify_completed;
-    bool m_completed = true;
+    std::atomic<bool> m_completed{ true };
 };
@@ -26,7 +26,7 @@ aiCamera::Sample* aiCamera::newSample()
     return new Sample(this);
 }
 
-void aiCamera::readSampleBody(Sample& sample, uint64_t idx)
+void aiCamera::readSampleBody(Sample& sample, uint64_t idx, bool force_update)
 {
     auto ss = aiIndexToSampleSelector(idx);
     auto ss2 = aiIndexToSampleSelector(idx + 1);
@@ -36,7 +36,7 @@ void aiCamera::readSampleBody(Sample& sample, uint64_t idx)
     m_schema.get(sample.cam_sp2, ss2);
 }
 
-void aiCamera::cookSampleBody(Sample& sample)
+void aiCamera::cookSampleBody(Sample& sample, bool index_changed, float time_offset)
 {
     auto& config = getConfig();
     auto& sp = sample.cam_sp;
@@ -54,11 +54,9 @@ void aiCamera::cookSampleBody(Sample& sample)
     dst.far_clip_plane = (float)sp.getFarClippingPlane() * config.scale_factor;
 
 
-    if (config.interpolate_samples && m_current_time_offset != 0)
+    if (config.interpolate_samples && time_offset != 0)
     {
         auto& sp2 = sample.cam_sp2;
-        float time_offset = (float)m_current_time_offset;
-
         dst.focal_length += time_offset * ((float)sp2.getFocalLength() - dst.focal_length);
         dst.sensor_size[0] += time_offset * (float)(sp2.getHorizontalAperture() * lensSizeFactor - dst.sensor_size[0]);
         dst.sensor_size[1] += time_offset * (float)(sp2.getVerticalAperture() * lensSizeFactor - dst.sensor_size[1]);
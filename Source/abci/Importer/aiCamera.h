@@ -28,6 +28,6 @@ public:
     aiCamera(aiObject *parent, const abcObject &abc);
 
     Sample* newSample() override;
-    void readSampleBody(Sample& sample, uint64_t idx) override;
-    void cookSampleBody(Sample& sample) override;
+    void readSampleBody(Sample& sample, uint64_t idx, bool force_update) override;
+    void cookSampleBody(Sample& sample, bool index_changed, float time_offset) override;
 };
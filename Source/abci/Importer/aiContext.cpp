@@ -2,13 +2,10 @@
 #include "aiInternal.h"
 #include "aiContext.h"
 #include "aiObject.h"
+#include "aiSchema.h"
 #include "aiAsync.h"
-#include <istream>
-#ifdef WIN32
-    #include <windows.h>
-    #include <io.h>
-    #include <fcntl.h>
-#endif
+#include "../Foundation/aiThreadPool.h"
+#include "aiArchive.h"
 
 static std::wstring L(const std::string& s)
 {
@@ -48,82 +45,30 @@ static std::string NormalizePath(const char *in_path)
     return S(path);
 }
 
-#ifdef WIN32
-class lockFreeIStream : public std::ifstream
+static bool VertexFormatChanged(const aiVertexFormat& a, const aiVertexFormat& b)
 {
-private:
-    HANDLE _handle;
-
-    FILE *Init(const wchar_t *name)
-    {
-        _handle = CreateFileW(name,
-            GENERIC_READ,
-            FILE_SHARE_DELETE | FILE_SHARE_READ | FILE_SHARE_WRITE,
-            NULL,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            NULL);
-        if (_handle == INVALID_HANDLE_VALUE)
-        {
-            auto errorMsg = GetLastErrorAsString();
-            std::cerr << "Alembic cannot open:" << name << ":" << errorMsg << std::endl;
-            return nullptr;
-        }
-
-        int nHandle = _open_osfhandle((long)_handle, _O_RDONLY);
-
-        if (nHandle == -1)
-        {
-            ::CloseHandle(_handle);
-            return nullptr;
-        }
-
-        auto fh = _fdopen(nHandle, "rb");
-        if (!fh)
-        {
-            ::CloseHandle(_handle);
-        }
-
-        return fh;
-    }
+    return a.normals != b.normals || a.tangents != b.tangents || a.uv != b.uv || a.colors != b.colors;
+}
 
-public:
-    lockFreeIStream(const wchar_t  *name) : std::ifstream(Init(name)) // Beware of constructors, initializers: Init changes the state of the class itself
-    {}
-    ~lockFreeIStream()
-    {
-        if (_handle != INVALID_HANDLE_VALUE)
-        {
-            auto errorMsg = GetLastErrorAsString();
-            std::cerr << "Alembic cannot close HANDLE:" << errorMsg << std::endl;
-            ::CloseHandle(_handle);
-        }
-    }
+static bool CookSettingsChanged(const aiConfig& a, const aiConfig& b)
+{
+    return a.normals_mode != b.normals_mode || a.tangents_mode != b.tangents_mode ||
+        a.scale_factor != b.scale_factor || a.vertex_motion_scale != b.vertex_motion_scale ||
+        a.split_unit != b.split_unit || a.swap_handedness != b.swap_handedness ||
+        a.swap_face_winding != b.swap_face_winding || a.interpolate_samples != b.interpolate_samples ||
+        a.import_point_polygon != b.import_point_polygon || a.import_line_polygon != b.import_line_polygon ||
+        a.import_triangle_polygon != b.import_triangle_polygon || a.hash_vertex_dedup != b.hash_vertex_dedup ||
+        a.bounds_mode != b.bounds_mode || a.index_format != b.index_format ||
+        VertexFormatChanged(a.vertex_format, b.vertex_format);
+}
 
-private:
-    std::string GetLastErrorAsString()
-    {
-        DWORD errorMessageID = ::GetLastError();
-        if (errorMessageID == 0)
-            return std::string();
-
-        LPSTR messageBuffer = nullptr;
-        size_t size =
-            FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                NULL,
-                errorMessageID,
-                MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                (LPSTR)&messageBuffer,
-                0,
-                NULL);
-
-        std::string message(messageBuffer, size);
-        LocalFree(messageBuffer);
-
-        return message;
-    }
-};
-#endif
+static bool ConfigChanged(const aiConfig& a, const aiConfig& b)
+{
+    return CookSettingsChanged(a, b) || a.aspect_ratio != b.aspect_ratio || a.worker_count != b.worker_count ||
+        a.prefetch_count != b.prefetch_count || a.sample_cache_budget != b.sample_cache_budget ||
+        a.stream_count != b.stream_count || a.lazy_hierarchy != b.lazy_hierarchy ||
+        a.dirty_ranges != b.dirty_ranges || a.map_archives != b.map_archives;
+}
 
 aiContextManager aiContextManager::s_instance;
 
@@ -155,6 +100,8 @@ void aiContextManager::destroyContext(int uid)
 void aiContextManager::destroyContextsWithPath(const char* asset_path)
 {
     auto path = NormalizePath(asset_path);
+    // the file may have been rewritten. contexts created from now on must not get the old archive
+    aiArchive::forget(path);
     for (auto it = s_instance.m_contexts.begin(); it != s_instance.m_contexts.end();)
     {
         if (it->second->getPath() == path)
@@ -180,6 +127,7 @@ aiContextManager::~aiContextManager()
 
 aiContext::aiContext(int uid)
     : m_uid(uid),
+      m_prefetch_tasks(new aiTaskGroup()),
       m_isHDF5(false)
 {
 }
@@ -194,6 +142,11 @@ Abc::IArchive aiContext::getArchive() const
     return m_archive;
 }
 
+aiArchive* aiContext::getSharedArchive() const
+{
+    return m_shared_archive.get();
+}
+
 const std::string& aiContext::getPath() const
 {
     return m_path;
@@ -260,34 +213,75 @@ const aiConfig& aiContext::getConfig() const
 
 void aiContext::setConfig(const aiConfig &config)
 {
+    // this is called on every update. prefetch tasks keep running unless something actually changed
+    if (!ConfigChanged(m_config, config))
+        return;
+
+    // prefetch tasks read the config
+    waitPrefetch();
+
+    // cooked samples depend on the settings. current and prefetched ones still hold the keys of the arrays they
+    // were cooked from, so the next update would take them as up to date. force every schema to read and cook again
+    if (CookSettingsChanged(m_config, config))
+    {
+        m_sample_cache.clear();
+        eachNodes([](aiObject& o) {
+            if (auto schema = dynamic_cast<aiSchema*>(&o))
+                schema->markForceUpdate();
+        });
+    }
+    m_sample_cache.setBudget((size_t)config.sample_cache_budget);
     m_config = config;
 }
 
+aiSampleCache& aiContext::getSampleCache()
+{
+    return m_sample_cache;
+}
+
+void aiContext::onNodesAdded()
+{
+    // can be called from load tasks. m_nodes is rebuilt on next use
+    m_nodes_dirty = true;
+}
+
+int aiContext::getWorkerCount() const
+{
+    // HDF5 is not thread safe
+    return m_isHDF5 ? 1 : aiResolveWorkerCount(m_config.worker_count);
+}
+
 void aiContext::gatherNodesRecursive(aiObject *n)
 {
-    auto& abc = n->getAbcObject();
-    size_t num_children = abc.getNumChildren();
+    n->gatherChildren();
 
-    for (size_t i = 0; i < num_children; ++i)
-    {
-        auto *child = n->newChild(abc.getChild(i));
-        gatherNodesRecursive(child);
-    }
+    // sibling subtrees are independent
+    int num_children = (int)n->getNumChildren();
+    aiParallelFor(num_children, n->getContext()->getWorkerCount(), [n](int i) {
+        if (auto child = n->getChild(i))
+            gatherNodesRecursive(child);
+    });
+}
+
+int aiContext::getStreamCount() const
+{
+    return m_config.stream_count > 0 ? m_config.stream_count : aiResolveWorkerCount(m_config.worker_count);
 }
 
 void aiContext::reset()
 {
+    waitPrefetch();
     waitAsync();
+    m_sample_cache.clear();
+    m_nodes.clear();
+    m_nodes_dirty = true;
     m_top_node.reset();
     m_timesamplings.clear();
     m_archive.reset();
+    m_shared_archive.reset();
 
     m_path.clear();
-    for (auto s : m_streams)
-    {
-        delete s;
-    }
-    m_streams.clear();
+    m_has_last_time = false;
 
     // m_config is not reset intentionally
 }
@@ -311,60 +305,19 @@ bool aiContext::load(const char *in_path)
     }
 
     m_path = path;
-    if (!m_archive.valid())
-    {
-        try
-        {
-            // Abc::IArchive doesn't accept wide string path. so create file stream with wide string path and pass it.
-            // (VisualC++'s std::ifstream accepts wide string)
-            m_streams.push_back(
-#ifdef WIN32
-                new lockFreeIStream(wpath.c_str())
-#elif __linux__
-                new std::ifstream(in_path, std::ios::in | std::ios::binary)
-#else
-                new std::ifstream(path.c_str(), std::ios::in | std::ios::binary)
-#endif
-            );
-
-            Alembic::AbcCoreOgawa::ReadArchive archive_reader(m_streams);
-            m_archive = Abc::IArchive(archive_reader(m_path), Abc::kWrapExisting, Abc::ErrorHandler::kThrowPolicy);
-            DebugLog("Successfully opened Ogawa archive");
-            m_isHDF5 = false;
-        }
-        catch (Alembic::Util::Exception e)
-        {
-            // HDF5 archive doesn't accept external stream. so close it.
-            // (that means if path contains wide characters, it can't be opened. I couldn't find solution..)
-            for (auto s : m_streams)
-            {
-                delete s;
-            }
-            m_streams.clear();
-
-            try
-            {
-                m_archive = Abc::IArchive(AbcCoreHDF5::ReadArchive(), path);
-                DebugLog("Successfully opened HDF5 archive");
-                m_isHDF5 = true;
-            }
-            catch (Alembic::Util::Exception e2)
-            {
-                auto message = L(e2.what());
-                DebugLogW(L"Failed to open archive: %s", message.c_str());
-            }
-        }
-    }
-    else
+    m_shared_archive = aiArchive::open(path, in_path, wpath, getStreamCount(), m_config.map_archives);
+    if (m_shared_archive)
     {
-        DebugLogW(L"Archive '%s' already opened", wpath.c_str());
+        m_archive = m_shared_archive->getArchive();
+        m_isHDF5 = m_shared_archive->isHDF5();
     }
 
     if (m_archive.valid())
     {
         abcObject abc_top = m_archive.getTop();
         m_top_node.reset(new aiObject(this, nullptr, abc_top));
-        gatherNodesRecursive(m_top_node.get());
+        if (!m_config.lazy_hierarchy)
+            gatherNodesRecursive(m_top_node.get());
 
         m_timesamplings.clear();
         auto num_time_samplings = (int)m_archive.getNumTimeSamplings();
@@ -386,24 +339,98 @@ aiObject* aiContext::getTopObject() const
     return m_top_node.get();
 }
 
+aiObject* aiContext::findObject(const char *path)
+{
+    // only the nodes along the path are created in lazy mode
+    aiObject *ret = m_top_node.get();
+    std::string name;
+    std::istringstream is(path ? path : "");
+    while (ret && std::getline(is, name, '/'))
+    {
+        if (!name.empty())
+            ret = ret->findChild(name);
+    }
+    return ret;
+}
+
 void aiContext::updateSamples(double time)
 {
+    waitPrefetch();
     waitAsync();
 
     auto ss = aiTimeToSampleSelector(time);
-    eachNodes([ss](aiObject& o) {
-        o.updateSample(ss);
-    });
+
+    int num_workers = getWorkerCount();
+    if (num_workers > 1)
+    {
+        updateSamplesParallel(ss, num_workers);
+    }
+    else
+    {
+        eachNodes([ss](aiObject& o) {
+            o.updateSample(ss);
+        });
+    }
 
     // kick async tasks!
     if (!m_async_tasks.empty())
     {
         aiAsyncManager::instance().queue(m_async_tasks.data(), m_async_tasks.size());
     }
+
+    kickPrefetch(time);
+}
+
+std::vector<aiObject*>& aiContext::getFlattenedNodes()
+{
+    if (m_nodes_dirty)
+    {
+        m_nodes_dirty = false;
+        m_nodes.clear();
+        eachNodes([this](aiObject& o) {
+            m_nodes.push_back(&o);
+        });
+    }
+    return m_nodes;
+}
+
+void aiContext::updateSamplesParallel(const abcSampleSelector& ss, int num_workers)
+{
+    auto& nodes = getFlattenedNodes();
+
+    // each node is updated (read and cook) entirely by one worker. nodes don't depend on each other's samples.
+    // m_nodes is in depth first order, so each worker starts on a contiguous set of subtrees.
+    aiParallelFor((int)nodes.size(), num_workers, [&nodes, &ss](int i) {
+        nodes[i]->updateSample(ss);
+    });
+}
+
+void aiContext::kickPrefetch(double time)
+{
+    // playback direction and rate are taken from the step between consecutive updates
+    double step = m_has_last_time ? time - m_last_time : 0.0;
+    m_last_time = time;
+    m_has_last_time = true;
+
+    // HDF5 is not thread safe
+    if (m_config.prefetch_count <= 0 || m_isHDF5 || step == 0.0)
+        return;
+
+    for (auto *node : getFlattenedNodes())
+        node->prefetchSamples(time, step, *m_prefetch_tasks, m_prefetch_cancel);
+}
+
+void aiContext::waitPrefetch()
+{
+    // samples being cooked are finished, the rest is dropped and requested again by the next kickPrefetch()
+    m_prefetch_cancel = true;
+    m_prefetch_tasks->wait();
+    m_prefetch_cancel = false;
 }
 
 void aiContext::queueAsync(aiAsync& task)
 {
+    std::lock_guard<std::mutex> lock(m_async_mutex);
     m_async_tasks.push_back(&task);
 }
 
@@ -5,6 +5,7 @@ using abcCamera = AbcGeom::ICamera;
 using abcPolyMesh = AbcGeom::IPolyMesh;
 using abcPoints = AbcGeom::IPoints;
 using abcProperties = AbcGeom::ICompoundProperty;
+using abcArraySampleKey = AbcCoreAbstract::ArraySampleKey;
 
 using abcBoolProperty = Abc::IBoolProperty;
 using abcIntProperty = Abc::IInt32Property;
@@ -25,9 +26,12 @@ using abcFloat4ArrayProperty = Abc::IC4fArrayProperty;
 using abcFloat4x4ArrayProperty = Abc::IM44fArrayProperty;
 
 class aiObject;
+class aiArchive;
 class aiAsync;
+class aiTaskGroup;
 
 #include "aiTimeSampling.h"
+#include "aiSampleCache.h"
 
 
 class aiContextManager
@@ -58,9 +62,12 @@ public:
     void setConfig(const aiConfig &config);
 
     aiObject* getTopObject() const;
+    aiObject* findObject(const char *path);
     void updateSamples(double time);
 
     Abc::IArchive getArchive() const;
+    // shared with other contexts that loaded the same path
+    aiArchive* getSharedArchive() const;
     const std::string& getPath() const;
     int getUid() const;
 
@@ -71,8 +78,16 @@ public:
     int getTimeSamplingCount();
     int getTimeSamplingIndex(Abc::TimeSamplingPtr ts);
 
+    aiSampleCache& getSampleCache();
+    void onNodesAdded();
+    // threads for update and load. always 1 for HDF5 archives
+    int getWorkerCount() const;
+    int getStreamCount() const;
+
     void queueAsync(aiAsync& task);
     void waitAsync();
+    // finish prefetch tasks in flight. anything that changes schema state outside updateSamples() calls this first
+    void waitPrefetch();
     bool getIsHDF5() const { return m_isHDF5; }
 
     template<class F>
@@ -81,17 +96,28 @@ public:
 private:
     static void gatherNodesRecursive(aiObject *n);
     void reset();
+    std::vector<aiObject*>& getFlattenedNodes();
+    void updateSamplesParallel(const abcSampleSelector& ss, int num_workers);
+    void kickPrefetch(double time);
 
     std::string m_path;
-    std::vector<std::istream*> m_streams;
-
+    std::shared_ptr<aiArchive> m_shared_archive;
     Abc::IArchive m_archive;
     std::unique_ptr<aiObject> m_top_node;
     std::vector<aiTimeSamplingPtr> m_timesamplings;
     int m_uid = 0;
     aiConfig m_config;
+    aiSampleCache m_sample_cache;
 
+    std::vector<aiObject*> m_nodes; // flattened hierarchy for parallel update
+    std::atomic<bool> m_nodes_dirty{ true };
     std::vector<aiAsync*> m_async_tasks;
+    std::mutex m_async_mutex;
+
+    std::unique_ptr<aiTaskGroup> m_prefetch_tasks;
+    std::atomic<bool> m_prefetch_cancel{ false };
+    double m_last_time = 0.0;
+    bool m_has_last_time = false;
     bool m_isHDF5;
 };
 
@@ -7,6 +7,7 @@
 #include "aiPolyMesh.h"
 #include "aiCamera.h"
 #include "aiPoints.h"
+#include "../Foundation/aiThreadPool.h"
 
 
 static std::string SanitizeNodeName(const std::string& src)
@@ -80,6 +81,14 @@ aiObject::~aiObject()
 }
 
 aiObject* aiObject::newChild(const abcObject &abc)
+{
+    aiObject *ret = makeChild(abc);
+    if (ret)
+        m_children.emplace_back(ret);
+    return ret;
+}
+
+aiObject* aiObject::makeChild(const abcObject &abc)
 {
     aiObject *ret = nullptr;
     if (abc.valid())
@@ -97,9 +106,59 @@ aiObject* aiObject::newChild(const abcObject &abc)
         else
             ret = new aiObject(m_ctx, this, abc);
     }
+    return ret;
+}
+
+void aiObject::gatherChildren()
+{
+    if (m_children_gathered)
+        return;
+    m_children_gathered = true;
+
+    // children findChild() already created are kept. the rest are created here, and all end up in archive order
+    int num_children = (int)m_abc.getNumChildren();
+    std::vector<ObjectPtr> children(num_children);
+    if (!m_children.empty())
+    {
+        std::map<std::string, ObjectPtr*> created;
+        for (auto& c : m_children)
+            created[c->getAbcObject().getName()] = &c;
+        for (int i = 0; i < num_children; ++i)
+        {
+            auto it = created.find(m_abc.getChildHeader(i).getName());
+            if (it != created.end())
+                children[i] = std::move(*it->second);
+        }
+    }
+
+    // setting up schemas (property and face set scans, summaries) is independent per child. construct them in parallel
+    aiParallelFor(num_children, m_ctx->getWorkerCount(), [this, &children](int i) {
+        if (!children[i])
+            children[i].reset(makeChild(m_abc.getChild(i)));
+    });
+    m_children.clear();
+    for (auto& child : children)
+    {
+        if (child)
+            m_children.push_back(std::move(child));
+    }
+    if (!m_children.empty())
+        m_ctx->onNodesAdded();
+}
 
+aiObject* aiObject::findChild(const std::string& name)
+{
+    auto it = std::find_if(m_children.begin(), m_children.end(),
+        [&name](ObjectPtr& c) { return c->getAbcObject().getName() == name; });
+    if (it != m_children.end())
+        return it->get();
+    if (m_children_gathered)
+        return nullptr;
+
+    // with aiConfig::lazy_hierarchy, create only the requested child, not its siblings
+    aiObject *ret = newChild(m_abc.getChild(name));
     if (ret)
-        m_children.emplace_back(ret);
+        m_ctx->onNodesAdded();
     return ret;
 }
 
@@ -120,10 +179,21 @@ const aiConfig& aiObject::getConfig() const { return m_ctx->getConfig(); }
 abcObject&  aiObject::getAbcObject()        { return m_abc; }
 const char* aiObject::getName() const       { return m_name.c_str(); }
 const char* aiObject::getFullName() const   { return m_fullname.c_str(); }
-uint32_t    aiObject::getNumChildren() const{ return (uint32_t)m_children.size(); }
-aiObject*   aiObject::getChild(int i)       { return m_children[i].get(); }
+// the archive's count. children may not be created yet with aiConfig::lazy_hierarchy, getChild() creates them
+uint32_t    aiObject::getNumChildren() const { return (uint32_t)m_abc.getNumChildren(); }
 aiObject*   aiObject::getParent() const     { return m_parent; }
-void        aiObject::setEnabled(bool v)    { m_enabled = v; }
+
+aiObject* aiObject::getChild(int i)
+{
+    gatherChildren();
+    return i >= 0 && (size_t)i < m_children.size() ? m_children[i].get() : nullptr;
+}
+
+void aiObject::setEnabled(bool v)
+{
+    m_ctx->waitPrefetch();
+    m_enabled = v;
+}
 
 aiSample* aiObject::getSample()
 {
@@ -137,3 +207,7 @@ void aiObject::updateSample(const abcSampleSelector& ss)
 void aiObject::waitAsync()
 {
 }
+
+void aiObject::prefetchSamples(double time, double step, aiTaskGroup& tasks, const std::atomic<bool>& cancel)
+{
+}
@@ -4,6 +4,7 @@ class aiSchema;
 class aiXform;
 class aiPolyMesh;
 class aiCamera;
+class aiTaskGroup;
 
 class aiObject
 {
@@ -16,12 +17,15 @@ public:
     const char* getFullName() const;
     uint32_t    getNumChildren() const;
     aiObject*   getChild(int i);
+    aiObject*   findChild(const std::string& name);
     aiObject*   getParent() const;
     void        setEnabled(bool v);
 
     virtual aiSample* getSample();
     virtual void updateSample(const abcSampleSelector& ss);
     virtual void waitAsync();
+    // queue background read & cook of the samples following time. step: time advanced per update
+    virtual void prefetchSamples(double time, double step, aiTaskGroup& tasks, const std::atomic<bool>& cancel);
 
 
     template<class F>
@@ -47,10 +51,14 @@ public:
     abcObject&  getAbcObject();
     aiObject*   newChild(const abcObject &abc);
     void        removeChild(aiObject *c);
+    // create child objects if not yet. with aiConfig::lazy_hierarchy, this is deferred until children are accessed
+    void        gatherChildren();
 
 protected:
     using ObjectPtr = std::unique_ptr<aiObject>;
 
+    aiObject*   makeChild(const abcObject &abc);
+
 #ifdef aiDebug
     std::string m_fullname; // just for convenience to debug
 #endif
@@ -61,4 +69,5 @@ protected:
     std::string m_name;     //
     std::string m_fullname; // sanitized
     bool m_enabled = true;
+    bool m_children_gathered = false;
 };
@@ -69,6 +69,13 @@ void aiPointsSample::getSummary(aiPointsSampleSummary & dst)
     dst.count = (int)m_points.size();
 }
 
+size_t aiPointsSample::getByteSize() const
+{
+    return sizeof(*this) + ByteSize(m_points_sp) + ByteSize(m_points_sp2) + ByteSize(m_velocities_sp) + ByteSize(m_ids_sp) +
+        ByteSize(m_sort_data) + ByteSize(m_points) + ByteSize(m_points2) + ByteSize(m_points_int) + ByteSize(m_points_prev) +
+        ByteSize(m_velocities) + ByteSize(m_ids);
+}
+
 aiPoints::aiPoints(aiObject *parent, const abcObject &abc)
     : super(parent, abc)
 {
@@ -117,7 +124,7 @@ aiPoints::Sample* aiPoints::newSample()
     return new Sample(this);
 }
 
-void aiPoints::readSampleBody(Sample & sample, uint64_t idx)
+void aiPoints::readSampleBody(Sample & sample, uint64_t idx, bool force_update)
 {
     auto ss = aiIndexToSampleSelector(idx);
     auto ss2 = aiIndexToSampleSelector(idx + 1);
@@ -152,16 +159,16 @@ void aiPoints::readSampleBody(Sample & sample, uint64_t idx)
     }
 }
 
-void aiPoints::cookSampleBody(Sample& sample)
+void aiPoints::cookSampleBody(Sample& sample, bool index_changed, float time_offset)
 {
     auto& summary = getSummary();
     auto& config = getConfig();
 
-    if (!summary.interpolate_points && !m_sample_index_changed)
+    if (!summary.interpolate_points && !index_changed)
         return;
 
     int point_count = (int)sample.m_points_sp->size();
-    if (m_sample_index_changed)
+    if (index_changed)
     {
         if (m_sort)
         {
@@ -232,7 +239,7 @@ void aiPoints::cookSampleBody(Sample& sample)
 
         sample.m_points_int.resize_discard(sample.m_points.size());
         Lerp(sample.m_points_int.data(), sample.m_points.data(), sample.m_points2.data(),
-            (int)sample.m_points.size(), m_current_time_offset);
+            (int)sample.m_points.size(), time_offset);
         sample.m_points_ref = sample.m_points_int;
 
         if (summary.compute_velocities)
@@ -251,6 +258,17 @@ void aiPoints::cookSampleBody(Sample& sample)
     }
 }
 
+bool aiPoints::canHoldMultipleSamples() const
+{
+    // sorted order depends on the sort position given at update time
+    return !m_sort;
+}
+
+void aiPoints::onSampleSwapped(Sample& current, Sample& previous)
+{
+    current.m_points_int.swap(previous.m_points_int);
+}
+
 void aiPoints::setSort(bool v) { m_sort = v; }
 bool aiPoints::getSort() const { return m_sort; }
 void aiPoints::setSortPosition(const abcV3& v) { m_sort_position = v; }
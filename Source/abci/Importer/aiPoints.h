@@ -15,6 +15,7 @@ public:
     ~aiPointsSample();
     void fillData(aiPointsData &dst);
     void getSummary(aiPointsSampleSummary &dst);
+    size_t getByteSize() const override;
 
 public:
     Abc::P3fArraySamplePtr m_points_sp, m_points_sp2;
@@ -47,14 +48,18 @@ public:
     const aiPointsSummaryInternal& getSummary() const;
 
     Sample* newSample() override;
-    void readSampleBody(Sample& sample, uint64_t idx) override;
-    void cookSampleBody(Sample& sample) override;
+    void readSampleBody(Sample& sample, uint64_t idx, bool force_update) override;
+    void cookSampleBody(Sample& sample, bool index_changed, float time_offset) override;
 
     void setSort(bool v);
     bool getSort() const;
     void setSortPosition(const abcV3& v);
     const abcV3& getSortPosition() const;
 
+protected:
+    bool canHoldMultipleSamples() const override;
+    void onSampleSwapped(Sample& current, Sample& previous) override;
+
 private:
     aiPointsSummaryInternal m_summary;
     bool m_sort = false;
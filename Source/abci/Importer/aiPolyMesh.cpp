@@ -4,6 +4,7 @@
 #include "aiObject.h"
 #include "aiSchema.h"
 #include "aiPolyMesh.h"
+#include "aiArchive.h"
 #include "../Foundation/aiMisc.h"
 #include "../Foundation/aiMath.h"
 
@@ -46,6 +47,33 @@ inline void Remap(RawVector<T>& dst, const AbcArraySample& src, const RawVector<
     }
 }
 
+// Remap() with the handedness flip and scale folded into mul, in one pass
+template<class T, class AbcArraySample>
+inline void RemapTransform(RawVector<T>& dst, const AbcArraySample& src, const RawVector<int>& indices, const T& mul)
+{
+    size_t num = indices.empty() ? src.size() : indices.size();
+    dst.resize_discard(num);
+    RemapTransform(dst.data(), (const T*)src.get(), indices.empty() ? nullptr : indices.data(), (int)num, mul);
+}
+
+// the same for both samples of an interpolation pair
+template<class T, class AbcArraySample>
+inline void RemapTransform(RawVector<T>& dst1, RawVector<T>& dst2, const AbcArraySample& src1, const AbcArraySample& src2,
+    const RawVector<int>& indices, const T& mul)
+{
+    if (src1.size() != src2.size())
+    {
+        RemapTransform(dst1, src1, indices, mul);
+        RemapTransform(dst2, src2, indices, mul);
+        return;
+    }
+    size_t num = indices.empty() ? src1.size() : indices.size();
+    dst1.resize_discard(num);
+    dst2.resize_discard(num);
+    RemapTransform(dst1.data(), dst2.data(), (const T*)src1.get(), (const T*)src2.get(),
+        indices.empty() ? nullptr : indices.data(), (int)num, mul);
+}
+
 template<class T>
 inline void Lerp(RawVector<T>& dst, const RawVector<T>& src1, const RawVector<T>& src2, float w)
 {
@@ -66,6 +94,7 @@ void aiMeshTopology::clear()
 {
     m_indices_sp.reset();
     m_counts_sp.reset();
+    m_indices_key = m_counts_key = aiArrayKey();
     m_faceset_sps.clear();
 
     m_refiner.clear();
@@ -104,6 +133,16 @@ int aiMeshTopology::getSubmeshCount(int split_index) const
     return (int)m_refiner.splits[split_index].submesh_count;
 }
 
+size_t aiMeshTopology::getByteSize() const
+{
+    return ByteSize(m_indices_sp) + ByteSize(m_counts_sp) + ByteSize(m_material_ids) +
+        ByteSize(m_refiner.new2old_points) + ByteSize(m_refiner.new_indices) + ByteSize(m_refiner.new_indices_tri) +
+        ByteSize(m_refiner.new_indices_lines) + ByteSize(m_refiner.new_indices_points) + ByteSize(m_refiner.new_indices_submeshes) +
+        ByteSize(m_refiner.new_indices_submeshes16) +
+        ByteSize(m_remap_points) + ByteSize(m_remap_normals) + ByteSize(m_remap_uv0) + ByteSize(m_remap_uv1) +
+        ByteSize(m_remap_rgba) + ByteSize(m_remap_rgb);
+}
+
 aiPolyMeshSample::aiPolyMeshSample(aiPolyMesh *schema, TopologyPtr topo)
     : super(schema)
     , m_topology(topo)
@@ -112,6 +151,7 @@ aiPolyMeshSample::aiPolyMeshSample(aiPolyMesh *schema, TopologyPtr topo)
 
 aiPolyMeshSample::~aiPolyMeshSample()
 {
+    m_async_fill.wait();
 }
 
 void aiPolyMeshSample::reset()
@@ -141,6 +181,14 @@ void aiPolyMeshSample::getSummary(aiMeshSampleSummary &dst) const
     dst.vertex_count  = m_topology->getVertexCount();
     dst.index_count   = m_topology->getIndexCount();
     dst.topology_changed = m_topology_changed;
+    dst.unchanged_points = m_unchanged.points;
+    dst.unchanged_velocities = m_unchanged.velocities;
+    dst.unchanged_normals = m_unchanged.normals;
+    dst.unchanged_tangents = m_unchanged.tangents;
+    dst.unchanged_uv0 = m_unchanged.uv0;
+    dst.unchanged_uv1 = m_unchanged.uv1;
+    dst.unchanged_rgba = m_unchanged.rgba;
+    dst.unchanged_rgb = m_unchanged.rgb;
 }
 
 void aiPolyMeshSample::getSplitSummaries(aiMeshSplitSummary  *dst) const
@@ -168,9 +216,51 @@ void aiPolyMeshSample::getSubmeshSummaries(aiSubmeshSummary *dst) const
         dst[i].submesh_index = src.submesh_index;
         dst[i].index_count   = src.index_count;
         dst[i].topology      = (aiTopology)src.topology;
+        dst[i].index_size    = src.index_size;
     }
 }
 
+void aiPolyMeshSample::getSplitDirtySummaries(aiMeshSplitDirtySummary *dst) const
+{
+    auto& schema = *static_cast<schema_t*>(getSchema());
+    int num_splits = m_topology->getSplitCount();
+    for (int i = 0; i < num_splits; ++i)
+    {
+        aiSplitDirtyRanges src;
+        schema.getDirtyRanges(*this, i, src);
+        auto& r = src.ranges;
+        dst[i].points     = r[(int)aiVertexAttribute::Points];
+        dst[i].velocities = r[(int)aiVertexAttribute::Velocities];
+        dst[i].normals    = r[(int)aiVertexAttribute::Normals];
+        dst[i].tangents   = r[(int)aiVertexAttribute::Tangents];
+        dst[i].uv0        = r[(int)aiVertexAttribute::UV0];
+        dst[i].uv1        = r[(int)aiVertexAttribute::UV1];
+        dst[i].rgba       = r[(int)aiVertexAttribute::RGBA];
+        dst[i].rgb        = r[(int)aiVertexAttribute::RGB];
+    }
+}
+
+size_t aiPolyMeshSample::getByteSize() const
+{
+    size_t ret = sizeof(*this) +
+        ByteSize(m_points_sp) + ByteSize(m_points_sp2) + ByteSize(m_velocities_sp) +
+        ByteSize(m_normals_sp) + ByteSize(m_normals_sp2) + ByteSize(m_uv0_sp) + ByteSize(m_uv0_sp2) +
+        ByteSize(m_uv1_sp) + ByteSize(m_uv1_sp2) + ByteSize(m_rgba_sp) + ByteSize(m_rgba_sp2) + ByteSize(m_rgb_sp) + ByteSize(m_rgb_sp2) +
+        ByteSize(m_points) + ByteSize(m_points2) + ByteSize(m_points_int) + ByteSize(m_points_prev) + ByteSize(m_velocities) +
+        ByteSize(m_uv0) + ByteSize(m_uv02) + ByteSize(m_uv0_int) + ByteSize(m_uv1) + ByteSize(m_uv12) + ByteSize(m_uv1_int) +
+        ByteSize(m_normals) + ByteSize(m_normals2) + ByteSize(m_normals_int) + ByteSize(m_tangents) +
+        ByteSize(m_rgba) + ByteSize(m_rgba2) + ByteSize(m_rgba_int) + ByteSize(m_rgb) + ByteSize(m_rgb2) + ByteSize(m_rgb_int) +
+        ByteSize(m_normals_q) + ByteSize(m_tangents_q) + ByteSize(m_uv0_q) + ByteSize(m_uv1_q) + ByteSize(m_rgba_q) + ByteSize(m_rgb_q) +
+        ByteSize(m_split_bounds);
+
+    // shared topology is not owned by the sample. heterogeneous samples with the same topology share it too
+    // (see aiPolyMesh::m_last_topology). only a topology the sample holds alone is charged, so none is counted twice
+    auto& schema = *static_cast<schema_t*>(getSchema());
+    if (schema.getSummary().topology_variance == aiTopologyVariance::Heterogenous && m_topology.use_count() == 1)
+        ret += m_topology->getByteSize();
+    return ret;
+}
+
 template<class T>
 static inline void copy_or_clear(T* dst, const IArray<T>& src, const MeshRefiner::Split& split)
 {
@@ -183,51 +273,266 @@ static inline void copy_or_clear(T* dst, const IArray<T>& src, const MeshRefiner
     }
 }
 
-template<class T1, class T2>
-static inline void copy_or_clear_3_to_4(T1* dst, const IArray<T2>& src, const MeshRefiner::Split& split)
+// widens 3 component elements of the split straight into dst. w goes to the 4th component
+template<class T4, class T3>
+static inline void expand_or_clear(T4* dst, const IArray<T3>& src, const MeshRefiner::Split& split, float w)
 {
     if (dst)
     {
-        if (!src.empty()) {
-            std::vector<T1> abc4(split.vertex_count);
-            std::transform(src.begin(), src.end(), abc4.begin(), [](const T2& c){ return T1{c.x, c.y, c.z, 1.f}; });
-            memcpy(dst, abc4.data() + split.vertex_offset, sizeof(T1) * split.vertex_count);
-        } else {
-            memset(dst, 0, split.vertex_count * sizeof(T1));
-        }
+        if (!src.empty())
+            Expand(dst, src.data() + split.vertex_offset, split.vertex_count, w);
+        else
+            memset(dst, 0, split.vertex_count * sizeof(T4));
     }
 }
 
+// vertex attributes fillSplitAttribute() copies one at a time. in the order of aiVertexAttribute
+enum FillAttribute
+{
+    FillPoints,
+    FillVelocities,
+    FillNormals,
+    FillTangents,
+    FillUV0,
+    FillUV1,
+    FillRGBA,
+    FillRGB,
+    FillAttributeCount,
+};
+
+// aiVertexAttribute bits of the buffers data receives
+static int FilledAttributes(const aiPolyMeshData& data)
+{
+    const void *buffers[FillAttributeCount] = {
+        data.points, data.velocities, data.normals, data.tangents, data.uv0, data.uv1, data.rgba, data.rgb };
+    int ret = 0;
+    for (int ai = 0; ai < FillAttributeCount; ++ai)
+    {
+        if (buffers[ai])
+            ret |= 1 << ai;
+    }
+    return ret;
+}
+
 void aiPolyMeshSample::fillSplitVertices(int split_index, aiPolyMeshData &data) const
 {
-    auto& schema = *dynamic_cast<schema_t*>(getSchema());
-    auto& summary = schema.getSummary();
+    for (int ai = 0; ai < FillAttributeCount; ++ai)
+        fillSplitAttribute(split_index, ai, data);
+    markFilled(split_index, FilledAttributes(data));
+}
+
+void aiPolyMeshSample::fillSplitAttribute(int split_index, int attribute, aiPolyMeshData &data) const
+{
     auto& splits = m_topology->m_refiner.splits;
     if (split_index < 0 || size_t(split_index) >= splits.size() || splits[split_index].vertex_count == 0)
         return;
 
-    auto& refiner = m_topology->m_refiner;
-    auto& split = refiner.splits[split_index];
-
-    if (data.points)
+    auto& split = splits[split_index];
+    auto& format = getConfig().vertex_format;
+    switch (attribute)
     {
-        m_points_ref.copy_to(data.points, split.vertex_count, split.vertex_offset);
+    case FillPoints:
+        if (data.points)
+        {
+            m_points_ref.copy_to(data.points, split.vertex_count, split.vertex_offset);
+            getSplitBounds(split_index, data.center, data.extents);
+        }
+        break;
+    // note: velocity can be empty even if summary.has_velocities is true (compute is enabled & first frame)
+    case FillVelocities: copy_or_clear(data.velocities, m_velocities_ref, split); break;
+    // attributes encoded by cook for aiConfig::vertex_format are copied as they are
+    case FillNormals:
+        if (format.normals == aiAttributeFormat::Oct16)
+            copy_or_clear((snorm16x2*)data.normals, IArray<snorm16x2>(m_normals_q), split);
+        else
+            copy_or_clear(data.normals, m_normals_ref, split);
+        break;
+    case FillTangents:
+        if (format.tangents == aiAttributeFormat::Oct16)
+            copy_or_clear((snorm16x4*)data.tangents, IArray<snorm16x4>(m_tangents_q), split);
+        else
+            copy_or_clear(data.tangents, m_tangents_ref, split);
+        break;
+    case FillUV0:
+        if (format.uv == aiAttributeFormat::Half16)
+            copy_or_clear((half16x2*)data.uv0, IArray<half16x2>(m_uv0_q), split);
+        else
+            copy_or_clear(data.uv0, m_uv0_ref, split);
+        break;
+    case FillUV1:
+        if (format.uv == aiAttributeFormat::Half16)
+            copy_or_clear((half16x2*)data.uv1, IArray<half16x2>(m_uv1_q), split);
+        else
+            copy_or_clear(data.uv1, m_uv1_ref, split);
+        break;
+    case FillRGBA:
+        if (format.colors == aiAttributeFormat::UNorm8)
+            copy_or_clear((unorm8x4*)data.rgba, IArray<unorm8x4>(m_rgba_q), split);
+        else
+            copy_or_clear((abcC4*)data.rgba, m_rgba_ref, split);
+        break;
+    case FillRGB:
+        if (format.colors == aiAttributeFormat::UNorm8)
+            copy_or_clear((unorm8x4*)data.rgb, IArray<unorm8x4>(m_rgb_q), split);
+        else
+            expand_or_clear((abcC4*)data.rgb, m_rgb_ref, split, 1.0f);
+        break;
+    }
+}
 
-        // bounds
+void aiPolyMeshSample::getSplitBounds(int split_index, abcV3& center, abcV3& extents) const
+{
+    // made by cook unless aiBoundsMode::ComputeOnFill
+    if (getConfig().bounds_mode != aiBoundsMode::ComputeOnFill && size_t(split_index) < m_split_bounds.size())
+    {
+        center = m_split_bounds[split_index].center;
+        extents = m_split_bounds[split_index].extents;
+    }
+    else
+    {
+        auto& split = m_topology->m_refiner.splits[split_index];
         abcV3 bbmin, bbmax;
-        MinMax(bbmin, bbmax, data.points, split.vertex_count);
-        data.center = (bbmin + bbmax) * 0.5f;
-        data.extents = bbmax - bbmin;
+        MinMax(bbmin, bbmax, m_points_ref.data() + split.vertex_offset, split.vertex_count);
+        center = (bbmin + bbmax) * 0.5f;
+        extents = bbmax - bbmin;
     }
+}
 
-    // note: velocity can be empty even if summary.has_velocities is true (compute is enabled & first frame)
-    copy_or_clear(data.velocities, m_velocities_ref, split);
-    copy_or_clear(data.normals, m_normals_ref, split);
-    copy_or_clear(data.tangents, m_tangents_ref, split);
-    copy_or_clear(data.uv0, m_uv0_ref, split);
-    copy_or_clear(data.uv1, m_uv1_ref, split);
-    copy_or_clear((abcC4*)data.rgba, m_rgba_ref, split);
-    copy_or_clear_3_to_4<abcC4, abcC3>((abcC4*)data.rgb, m_rgb_ref, split);
+// copies elements of Size bytes to a strided destination. the fixed size turns memcpy into plain moves
+template<int Size>
+static inline void CopyStrided(char *dst, int stride, const void *src_, int num)
+{
+    auto *src = (const char*)src_;
+    for (int i = 0; i < num; ++i)
+        memcpy(dst + (size_t)stride * i, src + Size * i, Size);
+}
+
+// converts src in blocks that stay in cache, then scatters them to the strided destination
+template<class Q, class T, class Convert>
+static inline void ConvertStrided(char *dst, int stride, const T *src, int num, const Convert& convert)
+{
+    const int block_size = 256;
+    Q tmp[block_size];
+    for (int i = 0; i < num; i += block_size)
+    {
+        int n = std::min(block_size, num - i);
+        convert(tmp, src + i, n);
+        CopyStrided<sizeof(Q)>(dst + (size_t)stride * i, stride, tmp, n);
+    }
+}
+
+template<class Q, class T>
+static inline void EncodeStrided(char *dst, int stride, const T *src, int num)
+{
+    ConvertStrided<Q>(dst, stride, src, num, [](Q *d, const T *s, int n) { Encode(d, s, n); });
+}
+
+static inline void ClearStrided(char *dst, int stride, int size, int num)
+{
+    for (int i = 0; i < num; ++i)
+        memset(dst + (size_t)stride * i, 0, size);
+}
+
+void aiPolyMeshSample::fillStreamElement(const aiVertexElement& e, char *dst, int first, int num) const
+{
+    switch (e.attribute)
+    {
+    case aiVertexAttribute::Points:
+        if (m_points_ref.empty())
+            ClearStrided(dst, e.stride, sizeof(abcV3), num);
+        else
+            CopyStrided<sizeof(abcV3)>(dst, e.stride, m_points_ref.data() + first, num);
+        break;
+    case aiVertexAttribute::Velocities:
+        if (m_velocities_ref.empty())
+            ClearStrided(dst, e.stride, sizeof(abcV3), num);
+        else
+            CopyStrided<sizeof(abcV3)>(dst, e.stride, m_velocities_ref.data() + first, num);
+        break;
+    case aiVertexAttribute::Normals:
+        if (m_normals_ref.empty())
+            ClearStrided(dst, e.stride, e.format == aiAttributeFormat::Oct16 ? sizeof(snorm16x2) : sizeof(abcV3), num);
+        else if (e.format == aiAttributeFormat::Oct16)
+            EncodeStrided<snorm16x2>(dst, e.stride, m_normals_ref.data() + first, num);
+        else
+            CopyStrided<sizeof(abcV3)>(dst, e.stride, m_normals_ref.data() + first, num);
+        break;
+    case aiVertexAttribute::Tangents:
+        if (m_tangents_ref.empty())
+            ClearStrided(dst, e.stride, e.format == aiAttributeFormat::Oct16 ? sizeof(snorm16x4) : sizeof(abcV4), num);
+        else if (e.format == aiAttributeFormat::Oct16)
+            EncodeStrided<snorm16x4>(dst, e.stride, m_tangents_ref.data() + first, num);
+        else
+            CopyStrided<sizeof(abcV4)>(dst, e.stride, m_tangents_ref.data() + first, num);
+        break;
+    case aiVertexAttribute::UV0:
+    case aiVertexAttribute::UV1:
+    {
+        auto& src = e.attribute == aiVertexAttribute::UV0 ? m_uv0_ref : m_uv1_ref;
+        if (src.empty())
+            ClearStrided(dst, e.stride, e.format == aiAttributeFormat::Half16 ? sizeof(half16x2) : sizeof(abcV2), num);
+        else if (e.format == aiAttributeFormat::Half16)
+            EncodeStrided<half16x2>(dst, e.stride, src.data() + first, num);
+        else
+            CopyStrided<sizeof(abcV2)>(dst, e.stride, src.data() + first, num);
+        break;
+    }
+    case aiVertexAttribute::RGBA:
+        if (m_rgba_ref.empty())
+            ClearStrided(dst, e.stride, e.format == aiAttributeFormat::UNorm8 ? sizeof(unorm8x4) : sizeof(abcC4), num);
+        else if (e.format == aiAttributeFormat::UNorm8)
+            EncodeStrided<unorm8x4>(dst, e.stride, m_rgba_ref.data() + first, num);
+        else
+            CopyStrided<sizeof(abcC4)>(dst, e.stride, m_rgba_ref.data() + first, num);
+        break;
+    case aiVertexAttribute::RGB:
+        if (m_rgb_ref.empty())
+            ClearStrided(dst, e.stride, e.format == aiAttributeFormat::UNorm8 ? sizeof(unorm8x4) : sizeof(abcC4), num);
+        else if (e.format == aiAttributeFormat::UNorm8)
+            EncodeStrided<unorm8x4>(dst, e.stride, m_rgb_ref.data() + first, num);
+        else
+            ConvertStrided<abcC4>(dst, e.stride, m_rgb_ref.data() + first, num,
+                [](abcC4 *d, const abcC3 *s, int n) { Expand(d, s, n, 1.0f); });
+        break;
+    }
+}
+
+void aiPolyMeshSample::fillSplitStream(int split_index, aiVertexStreamData& data) const
+{
+    auto& splits = m_topology->m_refiner.splits;
+    if (split_index < 0 || size_t(split_index) >= splits.size() || splits[split_index].vertex_count == 0 || !data.data)
+        return;
+
+    // below this, copies are cheaper than waking workers
+    const int min_parallel_vertices = 0x10000;
+    const int block_size = 4096;
+
+    // each block writes all elements of its vertices, so a block's part of the stream is written once while in cache
+    auto& split = splits[split_index];
+    int num = split.vertex_count;
+    int num_workers = num >= min_parallel_vertices ? getSchema()->getContext()->getWorkerCount() : 1;
+    aiParallelFor((num + block_size - 1) / block_size, num_workers, [&](int bi) {
+        int begin = bi * block_size;
+        int n = std::min(block_size, num - begin);
+        for (int ei = 0; ei < data.element_count; ++ei)
+        {
+            auto& e = data.elements[ei];
+            char *dst = (char*)data.data + e.offset + (size_t)e.stride * begin;
+            fillStreamElement(e, dst, split.vertex_offset + begin, n);
+        }
+    });
+
+    getSplitBounds(split_index, data.center, data.extents);
+
+    int filled = 0;
+    for (int ei = 0; ei < data.element_count; ++ei)
+        filled |= 1 << (int)data.elements[ei].attribute;
+    markFilled(split_index, filled);
+}
+
+void aiPolyMeshSample::markFilled(int split_index, int attribute_mask) const
+{
+    static_cast<schema_t*>(getSchema())->clearDirtyRanges(*this, split_index, attribute_mask);
 }
 
 void aiPolyMeshSample::fillSubmeshIndices(int submesh_index, aiSubmeshData &data) const
@@ -237,20 +542,105 @@ void aiPolyMeshSample::fillSubmeshIndices(int submesh_index, aiSubmeshData &data
 
     auto& refiner = m_topology->m_refiner;
     auto& submesh = refiner.submeshes[submesh_index];
-    refiner.new_indices_submeshes.copy_to(data.indices, submesh.index_count, submesh.index_offset);
+    if (submesh.index_size == 2)
+        refiner.new_indices_submeshes16.copy_to((uint16_t*)data.indices, submesh.index_count, submesh.index_offset);
+    else
+        refiner.new_indices_submeshes.copy_to((int*)data.indices, submesh.index_count, submesh.index_offset);
+}
+
+// the part of src that belongs to the split. empty if src doesn't cover it
+template<class T, class Container>
+static inline aiBufferView split_view(const Container& src, const MeshRefiner::Split& split)
+{
+    aiBufferView ret;
+    if (src.size() >= size_t(split.vertex_offset + split.vertex_count))
+    {
+        ret.data = src.data() + split.vertex_offset;
+        ret.count = split.vertex_count;
+        ret.element_size = sizeof(T);
+    }
+    return ret;
+}
+
+void aiPolyMeshSample::getSplitView(int split_index, aiPolyMeshSplitView& dst) const
+{
+    dst = aiPolyMeshSplitView();
+    auto& splits = m_topology->m_refiner.splits;
+    if (split_index < 0 || size_t(split_index) >= splits.size() || splits[split_index].vertex_count == 0)
+        return;
+
+    auto& split = splits[split_index];
+    auto& format = getConfig().vertex_format;
+    dst.points = split_view<abcV3>(m_points_ref, split);
+    dst.velocities = split_view<abcV3>(m_velocities_ref, split);
+    dst.normals = format.normals == aiAttributeFormat::Oct16 ?
+        split_view<snorm16x2>(m_normals_q, split) : split_view<abcV3>(m_normals_ref, split);
+    dst.tangents = format.tangents == aiAttributeFormat::Oct16 ?
+        split_view<snorm16x4>(m_tangents_q, split) : split_view<abcV4>(m_tangents_ref, split);
+    dst.uv0 = format.uv == aiAttributeFormat::Half16 ?
+        split_view<half16x2>(m_uv0_q, split) : split_view<abcV2>(m_uv0_ref, split);
+    dst.uv1 = format.uv == aiAttributeFormat::Half16 ?
+        split_view<half16x2>(m_uv1_q, split) : split_view<abcV2>(m_uv1_ref, split);
+    dst.rgba = format.colors == aiAttributeFormat::UNorm8 ?
+        split_view<unorm8x4>(m_rgba_q, split) : split_view<abcC4>(m_rgba_ref, split);
+    dst.rgb = format.colors == aiAttributeFormat::UNorm8 ?
+        split_view<unorm8x4>(m_rgb_q, split) : split_view<abcC3>(m_rgb_ref, split);
+    if (dst.points.data)
+        getSplitBounds(split_index, dst.center, dst.extents);
+}
+
+void aiPolyMeshSample::getSubmeshView(int submesh_index, aiBufferView& dst) const
+{
+    dst = aiBufferView();
+    auto& refiner = m_topology->m_refiner;
+    if (submesh_index < 0 || size_t(submesh_index) >= refiner.submeshes.size())
+        return;
+
+    auto& submesh = refiner.submeshes[submesh_index];
+    dst.count = submesh.index_count;
+    dst.element_size = submesh.index_size;
+    if (submesh.index_size == 2)
+        dst.data = refiner.new_indices_submeshes16.data() + submesh.index_offset;
+    else
+        dst.data = refiner.new_indices_submeshes.data() + submesh.index_offset;
 }
 
 void aiPolyMeshSample::fillVertexBuffer(aiPolyMeshData * vbs, aiSubmeshData * ibs)
 {
+    // below this, copies are cheaper than waking workers
+    const int min_parallel_vertices = 0x10000;
+
     auto &refiner = m_topology->m_refiner;
-    for (int spi = 0; spi < (int) refiner.splits.size(); ++spi)
-        fillSplitVertices(spi, vbs[spi]);
-    for (int smi = 0; smi < (int) refiner.submeshes.size(); ++smi)
-        fillSubmeshIndices(smi, ibs[smi]);
+    int num_splits = (int)refiner.splits.size();
+    int num_submeshes = (int)refiner.submeshes.size();
+    int num_workers = (int)m_points_ref.size() >= min_parallel_vertices ?
+        getSchema()->getContext()->getWorkerCount() : 1;
+
+    // one job per attribute of each split and one per submesh, so a single large split is spread as well.
+    // jobs write disjoint parts of the destination buffers
+    int num_vertex_jobs = num_splits * FillAttributeCount;
+    aiParallelFor(num_vertex_jobs + num_submeshes, num_workers, [&](int ji) {
+        if (ji < num_vertex_jobs)
+            fillSplitAttribute(ji / FillAttributeCount, ji % FillAttributeCount, vbs[ji / FillAttributeCount]);
+        else
+            fillSubmeshIndices(ji - num_vertex_jobs, ibs[ji - num_vertex_jobs]);
+    });
+
+    for (int si = 0; si < num_splits; ++si)
+        markFilled(si, FilledAttributes(vbs[si]));
+}
+
+aiAsyncTask* aiPolyMeshSample::fillVertexBufferAsync(aiPolyMeshData * vbs, aiSubmeshData * ibs)
+{
+    m_async_fill.wait();
+    m_async_fill.m_body = [this, vbs, ibs]() { fillVertexBuffer(vbs, ibs); };
+    aiAsyncManager::instance().queue(&m_async_fill);
+    return &m_async_fill;
 }
 
 aiPolyMesh::aiPolyMesh(aiObject *parent, const abcObject &abc)
     : super(parent, abc)
+    , m_constants(new aiPolyMeshConstants())
 {
     // find vertex color and additional uv params
     auto geom_params = m_schema.getArbGeomParams();
@@ -486,8 +876,11 @@ aiPolyMesh::Sample* aiPolyMesh::newSample()
 {
     if (!m_varying_topology)
     {
-        if (!m_shared_topology)
+        if (!m_shared_topology && !adoptSharedConstants())
+        {
             m_shared_topology.reset(new aiMeshTopology());
+            m_publish_constants = true;
+        }
         return new Sample(this, m_shared_topology);
     }
     else
@@ -496,33 +889,137 @@ aiPolyMesh::Sample* aiPolyMesh::newSample()
     }
 }
 
-void aiPolyMesh::readSampleBody(Sample& sample, uint64_t idx)
+// get the array sample of ss into dst unless dst already holds it. returns false if the read was skipped
+template<class Property, class SamplePtr>
+static bool ReadArray(const Property& prop, SamplePtr& dst, aiArrayKey& key, const abcSampleSelector& ss, bool reuse)
+{
+    aiArrayKey new_key;
+    new_key.valid = prop.getKey(new_key.values, ss);
+    key.reused = reuse && dst && new_key == key;
+    if (key.reused)
+        return false;
+
+    prop.get(dst, ss);
+    key = new_key;
+    return true;
+}
+
+template<class Param, class Sample>
+static bool ReadParam(const Param& param, Sample& dst, aiArrayKey& key, const abcSampleSelector& ss, bool reuse)
+{
+    aiArrayKey new_key;
+    new_key.valid = param.getValueProperty().getKey(new_key.values, ss) &&
+        (!param.isIndexed() || param.getIndexProperty().getKey(new_key.indices, ss));
+    key.reused = reuse && dst.valid() && new_key == key;
+    if (key.reused)
+        return false;
+
+    param.getIndexed(dst, ss);
+    key = new_key;
+    return true;
+}
+
+// true if the array of ss is the same as held. compares digests, or the data if the archive has no digests
+template<class Property, class SamplePtr>
+static bool IsSameArray(const Property& prop, const SamplePtr& held, const aiArrayKey& held_key, const abcSampleSelector& ss)
+{
+    if (!held)
+        return false;
+
+    aiArrayKey key;
+    key.valid = prop.getKey(key.values, ss);
+    if (key.valid && held_key.valid)
+        return key == held_key;
+
+    SamplePtr sp;
+    prop.get(sp, ss);
+    return sp && sp->size() == held->size() &&
+        memcmp(sp->get(), held->get(), sizeof(typename SamplePtr::element_type::value_type) * sp->size()) == 0;
+}
+
+bool aiPolyMesh::isSameTopology(const aiMeshTopology& topology, const abcSampleSelector& ss) const
+{
+    // face sets are part of the topology but have no public key. assume they change if they are animated
+    for (auto& fs : m_facesets)
+    {
+        if (!fs.isConstant())
+            return false;
+    }
+    auto& summary = m_summary;
+    return (!summary.has_counts || IsSameArray(m_schema.getFaceCountsProperty(), topology.m_counts_sp, topology.m_counts_key, ss)) &&
+        (!summary.has_indices || IsSameArray(m_schema.getFaceIndicesProperty(), topology.m_indices_sp, topology.m_indices_key, ss));
+}
+
+void aiPolyMesh::readSampleBody(Sample& sample, uint64_t idx, bool force_update)
 {
+    sample.m_async_fill.wait();
+
     auto ss = aiIndexToSampleSelector(idx);
     auto ss2 = aiIndexToSampleSelector(idx + 1);
 
     readVisibility(sample, ss);
 
-    auto& topology = *sample.m_topology;
-    auto& refiner = topology.m_refiner;
+    // forced updates rebuild the topology and constant data
+    if (force_update && m_constants_shared)
+        detachSharedConstants(sample);
+
     auto& summary = m_summary;
 
-    bool topology_changed = m_varying_topology || m_force_update_local;
+    bool topology_changed = m_varying_topology || force_update;
+    bool topology_swapped = false;
+    if (m_varying_topology && !force_update)
+    {
+        // heterogeneous meshes often keep the same topology for long stretches. keep the refined one in that case
+        if (isSameTopology(*sample.m_topology, ss))
+        {
+            topology_changed = false;
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(m_last_topology_mutex);
+            if (m_last_topology && m_last_topology != sample.m_topology && isSameTopology(*m_last_topology, ss))
+            {
+                // the sample was cooked with other topology (e.g. it comes from the prefetch ring). share the last one
+                sample.m_topology = m_last_topology;
+                topology_changed = false;
+                topology_swapped = true;
+            }
+        }
+    }
+    if (topology_changed && m_varying_topology)
+    {
+        // the topology is about to be rebuilt. it must not be reachable from other samples
+        std::lock_guard<std::mutex> lock(m_last_topology_mutex);
+        if (m_last_topology == sample.m_topology)
+            m_last_topology.reset();
+        if (sample.m_topology.use_count() > 1)
+            sample.m_topology.reset(new aiMeshTopology());
+    }
 
+    auto& topology = *sample.m_topology;
     if (topology_changed)
         topology.clear();
 
     // topology
     if (summary.has_counts && (!topology.m_counts_sp || topology_changed))
     {
-        m_schema.getFaceCountsProperty().get(topology.m_counts_sp, ss);
+        auto prop = m_schema.getFaceCountsProperty();
+        topology.m_counts_key.valid = prop.getKey(topology.m_counts_key.values, ss);
+        prop.get(topology.m_counts_sp, ss);
         topology_changed = true;
     }
     if (summary.has_indices && (!topology.m_indices_sp || topology_changed))
     {
-        m_schema.getFaceIndicesProperty().get(topology.m_indices_sp, ss);
+        auto prop = m_schema.getFaceIndicesProperty();
+        topology.m_indices_key.valid = prop.getKey(topology.m_indices_key.values, ss);
+        prop.get(topology.m_indices_sp, ss);
         topology_changed = true;
     }
+    if (m_varying_topology)
+    {
+        std::lock_guard<std::mutex> lock(m_last_topology_mutex);
+        m_last_topology = sample.m_topology;
+    }
 
     // face sets
     if (!m_facesets.empty() && topology_changed)
@@ -534,73 +1031,77 @@ void aiPolyMesh::readSampleBody(Sample& sample, uint64_t idx)
         }
     }
 
+    // array samples that are identical to the ones this sample already holds are neither read nor cooked again.
+    // cooked buffers depend on the topology, so it has to be the same too.
+    bool reuse = !topology_changed && !topology_swapped;
+
     // points
-    if (summary.has_points && m_constant_points.empty())
+    if (summary.has_points && m_constants->points.empty())
     {
         auto param = m_schema.getPositionsProperty();
-        param.get(sample.m_points_sp, ss);
+        ReadArray(param, sample.m_points_sp, sample.m_keys.points, ss, reuse);
         if (summary.interpolate_points)
         {
-            param.get(sample.m_points_sp2, ss2);
+            ReadArray(param, sample.m_points_sp2, sample.m_keys.points2, ss2, reuse);
         }
         else
         {
             if (summary.has_velocities_prop)
             {
-                m_schema.getVelocitiesProperty().get(sample.m_velocities_sp, ss);
+                ReadArray(m_schema.getVelocitiesProperty(), sample.m_velocities_sp, sample.m_keys.velocities, ss, reuse);
             }
         }
     }
 
     // normals
-    if (m_constant_normals.empty() && summary.has_normals_prop && !summary.compute_normals)
+    if (m_constants->normals.empty() && summary.has_normals_prop && !summary.compute_normals)
     {
         auto param = m_schema.getNormalsParam();
-        param.getIndexed(sample.m_normals_sp, ss);
+        ReadParam(param, sample.m_normals_sp, sample.m_keys.normals, ss, reuse);
         if (summary.interpolate_normals)
         {
-            param.getIndexed(sample.m_normals_sp2, ss2);
+            ReadParam(param, sample.m_normals_sp2, sample.m_keys.normals2, ss2, reuse);
         }
     }
 
     // uv0
-    if (m_constant_uv0.empty() && summary.has_uv0_prop)
+    if (m_constants->uv0.empty() && summary.has_uv0_prop)
     {
         auto param = m_schema.getUVsParam();
-        param.getIndexed(sample.m_uv0_sp, ss);
+        ReadParam(param, sample.m_uv0_sp, sample.m_keys.uv0, ss, reuse);
         if (summary.interpolate_uv0)
         {
-            param.getIndexed(sample.m_uv0_sp2, ss2);
+            ReadParam(param, sample.m_uv0_sp2, sample.m_keys.uv02, ss2, reuse);
         }
     }
 
     // uv1
-    if (m_constant_uv1.empty() && summary.has_uv1_prop)
+    if (m_constants->uv1.empty() && summary.has_uv1_prop)
     {
-        m_uv1_param.getIndexed(sample.m_uv1_sp, ss);
+        ReadParam(m_uv1_param, sample.m_uv1_sp, sample.m_keys.uv1, ss, reuse);
         if (summary.interpolate_uv1)
         {
-            m_uv1_param.getIndexed(sample.m_uv1_sp2, ss2);
+            ReadParam(m_uv1_param, sample.m_uv1_sp2, sample.m_keys.uv12, ss2, reuse);
         }
     }
 
     // colors
-    if (m_constant_rgba.empty() && summary.has_rgba_prop)
+    if (m_constants->rgba.empty() && summary.has_rgba_prop)
     {
-        m_rgba_param.getIndexed(sample.m_rgba_sp, ss);
+        ReadParam(m_rgba_param, sample.m_rgba_sp, sample.m_keys.rgba, ss, reuse);
         if (summary.interpolate_rgba)
         {
-            m_rgba_param.getIndexed(sample.m_rgba_sp2, ss2);
+            ReadParam(m_rgba_param, sample.m_rgba_sp2, sample.m_keys.rgba2, ss2, reuse);
         }
     }
 
     // rgb
-    if (m_constant_rgb.empty() && summary.has_rgb_prop)
+    if (m_constants->rgb.empty() && summary.has_rgb_prop)
     {
-        m_rgb_param.getIndexed(sample.m_rgb_sp, ss);
+        ReadParam(m_rgb_param, sample.m_rgb_sp, sample.m_keys.rgb, ss, reuse);
         if (summary.interpolate_rgb)
         {
-            m_rgb_param.getIndexed(sample.m_rgb_sp2, ss2);
+            ReadParam(m_rgb_param, sample.m_rgb_sp2, sample.m_keys.rgb2, ss2, reuse);
         }
     }
 
@@ -611,94 +1112,147 @@ void aiPolyMesh::readSampleBody(Sample& sample, uint64_t idx)
     sample.m_topology_changed = topology_changed;
 }
 
-void aiPolyMesh::cookSampleBody(Sample& sample)
+void aiPolyMesh::cookSampleBody(Sample& sample, bool index_changed, float time_offset)
 {
+    sample.m_async_fill.wait();
+
     auto& topology = *sample.m_topology;
     auto& refiner = topology.m_refiner;
     auto& config = getConfig();
     auto& summary = getSummary();
 
     // interpolation can't work with varying topology
-    if (m_varying_topology && !m_sample_index_changed)
+    if (m_varying_topology && !index_changed)
         return;
 
+    // attributes whose cooked buffers already hold the data of this sample (see ReadArray())
+    auto& keys = sample.m_keys;
+    bool same_points = index_changed && keys.points.reused && !summary.interpolate_points;
+    bool same_normals = summary.compute_normals ? same_points :
+        index_changed && keys.normals.reused && !summary.interpolate_normals;
+    bool same_uv0 = index_changed && keys.uv0.reused && !summary.interpolate_uv0;
+
+    // remap, handedness flip and scale are applied in one pass. when both samples of an interpolation pair are
+    // needed, they are remapped together
+    float scale = config.scale_factor;
+    float flip = config.swap_handedness ? -1.0f : 1.0f;
+    abcV3 points_mul{ flip * scale, scale, scale };
+    abcV3 normals_mul{ flip, 1.0f, 1.0f };
+    abcV2 uv_mul{ 1.0f, 1.0f };
+    abcC4 rgba_mul{ 1.0f, 1.0f, 1.0f, 1.0f };
+    bool remap_points2 = summary.interpolate_points && !keys.points2.reused;
+    bool remap_normals2 = summary.interpolate_normals && !keys.normals2.reused;
+    bool remap_uv02 = summary.interpolate_uv0 && !keys.uv02.reused;
+    bool remap_uv12 = summary.interpolate_uv1 && !keys.uv12.reused;
+    bool remap_rgba2 = summary.interpolate_rgba && !keys.rgba2.reused;
+
     if (sample.m_topology_changed)
     {
         onTopologyChange(sample);
     }
-    else if (m_sample_index_changed)
+    else if (index_changed)
     {
         onTopologyDetermined();
 
         // make remapped vertex buffer
-        if (!m_constant_points.empty())
+        if (!m_constants->points.empty())
         {
-            sample.m_points_ref = m_constant_points;
+            sample.m_points_ref = m_constants->points;
         }
         else
         {
-            Remap(sample.m_points, *sample.m_points_sp, topology.m_remap_points);
-            if (config.swap_handedness)
-                SwapHandedness(sample.m_points.data(), (int)sample.m_points.size());
-            if (config.scale_factor != 1.0f)
-                ApplyScale(sample.m_points.data(), (int)sample.m_points.size(), config.scale_factor);
+            if (!keys.points.reused)
+            {
+                if (remap_points2)
+                    RemapTransform(sample.m_points, sample.m_points2, *sample.m_points_sp, *sample.m_points_sp2, topology.m_remap_points, points_mul);
+                else
+                    RemapTransform(sample.m_points, *sample.m_points_sp, topology.m_remap_points, points_mul);
+                remap_points2 = false;
+            }
             sample.m_points_ref = sample.m_points;
         }
 
-        if (!m_constant_normals.empty())
+        if (!m_constants->normals.empty())
         {
-            sample.m_normals_ref = m_constant_normals;
+            sample.m_normals_ref = m_constants->normals;
         }
         else if (!summary.compute_normals && summary.has_normals_prop)
         {
-            Remap(sample.m_normals, *sample.m_normals_sp.getVals(), topology.m_remap_normals);
-            if (config.swap_handedness)
-                SwapHandedness(sample.m_normals.data(), (int)sample.m_normals.size());
+            if (!keys.normals.reused)
+            {
+                if (remap_normals2)
+                    RemapTransform(sample.m_normals, sample.m_normals2, *sample.m_normals_sp.getVals(), *sample.m_normals_sp2.getVals(), topology.m_remap_normals, normals_mul);
+                else
+                    RemapTransform(sample.m_normals, *sample.m_normals_sp.getVals(), topology.m_remap_normals, normals_mul);
+                remap_normals2 = false;
+            }
             sample.m_normals_ref = sample.m_normals;
         }
 
-        if (!m_constant_tangents.empty())
+        if (!m_constants->tangents.empty())
         {
-            sample.m_tangents_ref = m_constant_tangents;
+            sample.m_tangents_ref = m_constants->tangents;
         }
 
-        if (!m_constant_uv0.empty())
+        if (!m_constants->uv0.empty())
         {
-            sample.m_uv0_ref = m_constant_uv0;
+            sample.m_uv0_ref = m_constants->uv0;
         }
         else if (summary.has_uv0_prop)
         {
-            Remap(sample.m_uv0, *sample.m_uv0_sp.getVals(), topology.m_remap_uv0);
+            if (!keys.uv0.reused)
+            {
+                if (remap_uv02)
+                    RemapTransform(sample.m_uv0, sample.m_uv02, *sample.m_uv0_sp.getVals(), *sample.m_uv0_sp2.getVals(), topology.m_remap_uv0, uv_mul);
+                else
+                    RemapTransform(sample.m_uv0, *sample.m_uv0_sp.getVals(), topology.m_remap_uv0, uv_mul);
+                remap_uv02 = false;
+            }
             sample.m_uv0_ref = sample.m_uv0;
         }
 
-        if (!m_constant_uv1.empty())
+        if (!m_constants->uv1.empty())
         {
-            sample.m_uv1_ref = m_constant_uv1;
+            sample.m_uv1_ref = m_constants->uv1;
         }
         else if (summary.has_uv1_prop)
         {
-            Remap(sample.m_uv1, *sample.m_uv1_sp.getVals(), topology.m_remap_uv1);
+            if (!keys.uv1.reused)
+            {
+                if (remap_uv12)
+                    RemapTransform(sample.m_uv1, sample.m_uv12, *sample.m_uv1_sp.getVals(), *sample.m_uv1_sp2.getVals(), topology.m_remap_uv1, uv_mul);
+                else
+                    RemapTransform(sample.m_uv1, *sample.m_uv1_sp.getVals(), topology.m_remap_uv1, uv_mul);
+                remap_uv12 = false;
+            }
             sample.m_uv1_ref = sample.m_uv1;
         }
 
-        if (!m_constant_rgba.empty())
+        if (!m_constants->rgba.empty())
         {
-            sample.m_rgba_ref = m_constant_rgba;
+            sample.m_rgba_ref = m_constants->rgba;
         }
         else if (summary.has_rgba_prop)
         {
-            Remap(sample.m_rgba, *sample.m_rgba_sp.getVals(), topology.m_remap_rgba);
+            if (!keys.rgba.reused)
+            {
+                if (remap_rgba2)
+                    RemapTransform(sample.m_rgba, sample.m_rgba2, *sample.m_rgba_sp.getVals(), *sample.m_rgba_sp2.getVals(), topology.m_remap_rgba, rgba_mul);
+                else
+                    RemapTransform(sample.m_rgba, *sample.m_rgba_sp.getVals(), topology.m_remap_rgba, rgba_mul);
+                remap_rgba2 = false;
+            }
             sample.m_rgba_ref = sample.m_rgba;
         }
 
-        if (!m_constant_rgb.empty())
+        if (!m_constants->rgb.empty())
         {
-            sample.m_rgb_ref = m_constant_rgb;
+            sample.m_rgb_ref = m_constants->rgb;
         }
         else if (summary.has_rgb_prop)
         {
-            Remap(sample.m_rgb, *sample.m_rgb_sp.getVals(), topology.m_remap_rgb);
+            if (!keys.rgb.reused)
+                Remap(sample.m_rgb, *sample.m_rgb_sp.getVals(), topology.m_remap_rgb);
             sample.m_rgb_ref = sample.m_rgb;
         }
     }
@@ -707,58 +1261,39 @@ void aiPolyMesh::cookSampleBody(Sample& sample)
         onTopologyDetermined();
     }
 
-    if (m_sample_index_changed)
+    if (index_changed)
     {
         // both in the case of topology changed or sample index changed
 
-        if (summary.interpolate_points)
-        {
-            Remap(sample.m_points2, *sample.m_points_sp2, topology.m_remap_points);
-            if (config.swap_handedness)
-                SwapHandedness(sample.m_points2.data(), (int)sample.m_points2.size());
-            if (config.scale_factor != 1.0f)
-                ApplyScale(sample.m_points2.data(), (int)sample.m_points2.size(), config.scale_factor);
-        }
+        if (remap_points2)
+            RemapTransform(sample.m_points2, *sample.m_points_sp2, topology.m_remap_points, points_mul);
 
-        if (summary.interpolate_normals)
-        {
-            Remap(sample.m_normals2, *sample.m_normals_sp2.getVals(), topology.m_remap_normals);
-            if (config.swap_handedness)
-                SwapHandedness(sample.m_normals2.data(), (int)sample.m_normals2.size());
-        }
+        if (remap_normals2)
+            RemapTransform(sample.m_normals2, *sample.m_normals_sp2.getVals(), topology.m_remap_normals, normals_mul);
 
-        if (summary.interpolate_uv0)
-        {
-            Remap(sample.m_uv02, *sample.m_uv0_sp2.getVals(), topology.m_remap_uv0);
-        }
+        if (remap_uv02)
+            RemapTransform(sample.m_uv02, *sample.m_uv0_sp2.getVals(), topology.m_remap_uv0, uv_mul);
 
-        if (summary.interpolate_uv1)
-        {
-            Remap(sample.m_uv12, *sample.m_uv1_sp2.getVals(), topology.m_remap_uv1);
-        }
+        if (remap_uv12)
+            RemapTransform(sample.m_uv12, *sample.m_uv1_sp2.getVals(), topology.m_remap_uv1, uv_mul);
 
-        if (summary.interpolate_rgba)
-        {
-            Remap(sample.m_rgba2, *sample.m_rgba_sp2.getVals(), topology.m_remap_rgba);
-        }
+        if (remap_rgba2)
+            RemapTransform(sample.m_rgba2, *sample.m_rgba_sp2.getVals(), topology.m_remap_rgba, rgba_mul);
 
-        if (summary.interpolate_rgb)
+        if (summary.interpolate_rgb && !keys.rgb2.reused)
         {
             Remap(sample.m_rgb2, *sample.m_rgb_sp2.getVals(), topology.m_remap_rgb);
         }
 
-        if (!m_constant_velocities.empty())
+        if (!m_constants->velocities.empty())
         {
-            sample.m_velocities_ref = m_constant_velocities;
+            sample.m_velocities_ref = m_constants->velocities;
         }
         else if (!summary.compute_velocities && summary.has_velocities_prop)
         {
-            auto& dst = summary.constant_velocities ? m_constant_velocities : sample.m_velocities;
-            Remap(dst, *sample.m_velocities_sp, topology.m_remap_points);
-            if (config.swap_handedness)
-                SwapHandedness(dst.data(), (int)dst.size());
-            if (config.scale_factor != 1.0f)
-                ApplyScale(dst.data(), (int)dst.size(), config.scale_factor);
+            auto& dst = summary.constant_velocities && !m_constants_shared ? m_constants->velocities : sample.m_velocities;
+            if (!keys.velocities.reused || &dst != &sample.m_velocities)
+                RemapTransform(dst, *sample.m_velocities_sp, topology.m_remap_points, points_mul);
             sample.m_velocities_ref = dst;
         }
     }
@@ -771,7 +1306,7 @@ void aiPolyMesh::cookSampleBody(Sample& sample)
         if (summary.compute_velocities)
             sample.m_points_int.swap(sample.m_points_prev);
 
-        Lerp(sample.m_points_int, sample.m_points, sample.m_points2, m_current_time_offset);
+        Lerp(sample.m_points_int, sample.m_points, sample.m_points2, time_offset);
         sample.m_points_ref = sample.m_points_int;
 
         if (summary.compute_velocities)
@@ -791,17 +1326,17 @@ void aiPolyMesh::cookSampleBody(Sample& sample)
     }
 
     // normals
-    if (!m_constant_normals.empty())
+    if (!m_constants->normals.empty())
     {
         // do nothing
     }
     else if (summary.interpolate_normals)
     {
-        Lerp(sample.m_normals_int, sample.m_normals, sample.m_normals2, (float)m_current_time_offset);
+        Lerp(sample.m_normals_int, sample.m_normals, sample.m_normals2, time_offset);
         Normalize(sample.m_normals_int.data(), (int)sample.m_normals.size());
         sample.m_normals_ref = sample.m_normals_int;
     }
-    else if (summary.compute_normals && (m_sample_index_changed || summary.interpolate_points))
+    else if (summary.compute_normals && (index_changed || summary.interpolate_points) && !same_points)
     {
         if (sample.m_points_ref.empty())
         {
@@ -810,21 +1345,19 @@ void aiPolyMesh::cookSampleBody(Sample& sample)
         }
         else
         {
-            const auto &indices = topology.m_refiner.new_indices_tri;
             sample.m_normals.resize_discard(sample.m_points_ref.size());
-            GeneratePointNormals(topology.m_counts_sp->get(), topology.m_indices_sp->get(), sample.m_points_sp->get(),
-                    sample.m_normals.data(), topology.m_remap_points.data(), topology.m_counts_sp->size(),
-                    topology.m_remap_points.size(), sample.m_points_sp->size());
+            generatePointNormals(sample, sample.m_normals);
             sample.m_normals_ref = sample.m_normals;
         }
     }
 
     // tangents
-    if (!m_constant_tangents.empty())
+    if (!m_constants->tangents.empty())
     {
         // do nothing
     }
-    else if (summary.compute_tangents && (m_sample_index_changed || summary.interpolate_points || summary.interpolate_normals))
+    else if (summary.compute_tangents && (index_changed || summary.interpolate_points || summary.interpolate_normals) &&
+        !(same_points && same_normals && same_uv0))
     {
         if (sample.m_points_ref.empty() || sample.m_uv0_ref.empty() || sample.m_normals_ref.empty())
         {
@@ -836,7 +1369,7 @@ void aiPolyMesh::cookSampleBody(Sample& sample)
             const auto &indices = topology.m_refiner.new_indices_tri;
             sample.m_tangents.resize_discard(sample.m_points_ref.size());
             GenerateTangents(sample.m_tangents.data(), sample.m_points_ref.data(), sample.m_uv0_ref.data(), sample.m_normals_ref.data(),
-                indices.data(), (int)sample.m_points_ref.size(), (int)indices.size() / 3);
+                indices.data(), (int)sample.m_points_ref.size(), (int)indices.size() / 3, getContext()->getWorkerCount());
             sample.m_tangents_ref = sample.m_tangents;
         }
     }
@@ -844,30 +1377,47 @@ void aiPolyMesh::cookSampleBody(Sample& sample)
     // uv0
     if (summary.interpolate_uv0)
     {
-        Lerp(sample.m_uv0_int, sample.m_uv0, sample.m_uv02, m_current_time_offset);
+        Lerp(sample.m_uv0_int, sample.m_uv0, sample.m_uv02, time_offset);
         sample.m_uv0_ref = sample.m_uv0_int;
     }
 
     // uv1
     if (summary.interpolate_uv1)
     {
-        Lerp(sample.m_uv1_int, sample.m_uv1, sample.m_uv12, m_current_time_offset);
+        Lerp(sample.m_uv1_int, sample.m_uv1, sample.m_uv12, time_offset);
         sample.m_uv1_ref = sample.m_uv1_int;
     }
 
     // colors
     if (summary.interpolate_rgba)
     {
-        Lerp(sample.m_rgba_int, sample.m_rgba, sample.m_rgba2, m_current_time_offset);
+        Lerp(sample.m_rgba_int, sample.m_rgba, sample.m_rgba2, time_offset);
         sample.m_rgba_ref = sample.m_rgba_int;
     }
 
     // rgb
     if (summary.interpolate_rgb)
     {
-        Lerp(sample.m_rgb_int, sample.m_rgb, sample.m_rgb2, m_current_time_offset);
+        Lerp(sample.m_rgb_int, sample.m_rgb, sample.m_rgb2, time_offset);
         sample.m_rgb_ref = sample.m_rgb_int;
     }
+
+    // bounds
+    if (config.bounds_mode != aiBoundsMode::ComputeOnFill)
+        updateSplitBounds(sample, same_points);
+
+    // encoded buffers of attributes whose arrays were reused still hold this sample's data
+    aiMeshUnchangedFlags same;
+    same.normals = same_normals;
+    same.tangents = same_points && same_normals && same_uv0;
+    same.uv0 = same_uv0;
+    same.uv1 = index_changed && keys.uv1.reused && !summary.interpolate_uv1;
+    same.rgba = index_changed && keys.rgba.reused && !summary.interpolate_rgba;
+    same.rgb = index_changed && keys.rgb.reused && !summary.interpolate_rgb;
+    encodeAttributes(sample, same);
+
+    if (m_publish_constants && sample.m_topology_changed)
+        publishConstants();
 }
 
 void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
@@ -882,6 +1432,9 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
 
     refiner.clear();
     refiner.split_unit = config.split_unit;
+    refiner.worker_count = getContext()->getWorkerCount();
+    refiner.hash_dedup = config.hash_vertex_dedup;
+    refiner.index16 = config.index_format == aiIndexFormat::UInt16IfPossible;
     refiner.gen_points = config.import_point_polygon;
     refiner.gen_lines = config.import_line_polygon;
     refiner.gen_triangles = config.import_triangle_polygon;
@@ -899,7 +1452,7 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
     if (sample.m_normals_sp.valid() && !summary.compute_normals)
     {
         IArray<abcV3> src{ sample.m_normals_sp.getVals()->get(), sample.m_normals_sp.getVals()->size() };
-        auto& dst = summary.constant_normals ? m_constant_normals : sample.m_normals;
+        auto& dst = summary.constant_normals ? m_constants->normals : sample.m_normals;
 
         has_valid_normals = true;
         if (sample.m_normals_sp.isIndexed() && sample.m_normals_sp.getIndices()->size() == refiner.indices.size())
@@ -925,7 +1478,7 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
     if (sample.m_uv0_sp.valid())
     {
         IArray<abcV2> src{ sample.m_uv0_sp.getVals()->get(), sample.m_uv0_sp.getVals()->size() };
-        auto& dst = summary.constant_uv0 ? m_constant_uv0 : sample.m_uv0;
+        auto& dst = summary.constant_uv0 ? m_constants->uv0 : sample.m_uv0;
 
         has_valid_uv0 = true;
         if (sample.m_uv0_sp.isIndexed() && sample.m_uv0_sp.getIndices()->size() == refiner.indices.size())
@@ -951,7 +1504,7 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
     if (sample.m_uv1_sp.valid())
     {
         IArray<abcV2> src{ sample.m_uv1_sp.getVals()->get(), sample.m_uv1_sp.getVals()->size() };
-        auto& dst = summary.constant_uv1 ? m_constant_uv1 : sample.m_uv1;
+        auto& dst = summary.constant_uv1 ? m_constants->uv1 : sample.m_uv1;
 
         has_valid_uv1 = true;
         if (sample.m_uv1_sp.isIndexed() && sample.m_uv1_sp.getIndices()->size() == refiner.indices.size())
@@ -977,7 +1530,7 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
     if (sample.m_rgba_sp.valid())
     {
         IArray<abcC4> src{ sample.m_rgba_sp.getVals()->get(), sample.m_rgba_sp.getVals()->size() };
-        auto& dst = summary.constant_rgba ? m_constant_rgba : sample.m_rgba;
+        auto& dst = summary.constant_rgba ? m_constants->rgba : sample.m_rgba;
 
         has_valid_rgba = true;
         if (sample.m_rgba_sp.isIndexed() && sample.m_rgba_sp.getIndices()->size() == refiner.indices.size())
@@ -1003,7 +1556,7 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
     if (sample.m_rgb_sp.valid())
     {
         IArray<abcC3> src{ sample.m_rgb_sp.getVals()->get(), sample.m_rgb_sp.getVals()->size() };
-        auto& dst = summary.constant_rgb ? m_constant_rgb : sample.m_rgb;
+        auto& dst = summary.constant_rgb ? m_constants->rgb : sample.m_rgb;
 
         has_valid_rgb = true;
         if (sample.m_rgb_sp.isIndexed() && sample.m_rgb_sp.getIndices()->size() == refiner.indices.size())
@@ -1029,6 +1582,9 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
 
     refiner.refine();
     refiner.retopology(config.swap_face_winding);
+    // computed normals are gathered through the connection. build it here, while the topology is still private
+    if (summary.compute_normals && refiner.connection.v2f_counts.size() != refiner.points.size())
+        refiner.connection.buildConnection(refiner.indices, refiner.counts, refiner.points);
 
     // generate submeshes
     if (!topology.m_faceset_sps.empty())
@@ -1062,7 +1618,7 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
 
     topology.m_remap_points.swap(refiner.new2old_points);
     {
-        auto& points = summary.constant_points ? m_constant_points : sample.m_points;
+        auto& points = summary.constant_points ? m_constants->points : sample.m_points;
         points.swap((RawVector<abcV3>&)refiner.new_points);
         if (config.swap_handedness)
             SwapHandedness(points.data(), (int)points.size());
@@ -1073,7 +1629,7 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
 
     if (has_valid_normals)
     {
-        sample.m_normals_ref = !m_constant_normals.empty() ? m_constant_normals : sample.m_normals;
+        sample.m_normals_ref = !m_constants->normals.empty() ? m_constants->normals : sample.m_normals;
         if (config.swap_handedness)
             SwapHandedness(sample.m_normals_ref.data(), (int)sample.m_normals_ref.size());
     }
@@ -1083,46 +1639,502 @@ void aiPolyMesh::onTopologyChange(aiPolyMeshSample & sample)
     }
 
     if (has_valid_uv0)
-        sample.m_uv0_ref = !m_constant_uv0.empty() ? m_constant_uv0 : sample.m_uv0;
+        sample.m_uv0_ref = !m_constants->uv0.empty() ? m_constants->uv0 : sample.m_uv0;
     else
         sample.m_uv0_ref.reset();
 
     if (has_valid_uv1)
-        sample.m_uv1_ref = !m_constant_uv1.empty() ? m_constant_uv1 : sample.m_uv1;
+        sample.m_uv1_ref = !m_constants->uv1.empty() ? m_constants->uv1 : sample.m_uv1;
     else
         sample.m_uv1_ref.reset();
 
     if (has_valid_rgba)
-        sample.m_rgba_ref = !m_constant_rgba.empty() ? m_constant_rgba : sample.m_rgba;
+        sample.m_rgba_ref = !m_constants->rgba.empty() ? m_constants->rgba : sample.m_rgba;
     else
         sample.m_rgba_ref.reset();
 
     if (has_valid_rgb)
-        sample.m_rgb_ref = !m_constant_rgb.empty() ? m_constant_rgb : sample.m_rgb;
+        sample.m_rgb_ref = !m_constants->rgb.empty() ? m_constants->rgb : sample.m_rgb;
     else
         sample.m_rgb_ref.reset();
 
     if (summary.constant_normals && summary.compute_normals)
     {
-        const auto &indices = topology.m_refiner.new_indices_tri;
-        m_constant_normals.resize_discard(m_constant_points.size());
-        GeneratePointNormals(topology.m_counts_sp->get(), topology.m_indices_sp->get(), sample.m_points_sp->get(),
-                m_constant_normals.data(), topology.m_remap_points.data(), topology.m_counts_sp->size(),
-                topology.m_remap_points.size(), sample.m_points_sp->size());
-        sample.m_normals_ref = m_constant_normals;
+        m_constants->normals.resize_discard(m_constants->points.size());
+        generatePointNormals(sample, m_constants->normals);
+        sample.m_normals_ref = m_constants->normals;
     }
     if (summary.constant_tangents && summary.compute_tangents)
     {
         const auto &indices = topology.m_refiner.new_indices_tri;
-        m_constant_tangents.resize_discard(m_constant_points.size());
-        GenerateTangents(m_constant_tangents.data(), m_constant_points.data(), m_constant_uv0.data(), m_constant_normals.data(),
-            indices.data(), (int)m_constant_points.size(), (int)indices.size() / 3);
-        sample.m_tangents_ref = m_constant_tangents;
+        m_constants->tangents.resize_discard(m_constants->points.size());
+        GenerateTangents(m_constants->tangents.data(), m_constants->points.data(), m_constants->uv0.data(), m_constants->normals.data(),
+            indices.data(), (int)m_constants->points.size(), (int)indices.size() / 3, getContext()->getWorkerCount());
+        sample.m_tangents_ref = m_constants->tangents;
     }
 
     // velocities are done in later part of cookSampleBody()
 }
 
+bool aiPolyMesh::canHoldMultipleSamples() const
+{
+    // cooking a sample with new topology writes constant attributes that the current sample refers to
+    auto& summary = m_summary;
+    bool has_constant = summary.constant_points || summary.constant_velocities || summary.constant_normals ||
+        summary.constant_tangents || summary.constant_uv0 || summary.constant_uv1 || summary.constant_rgba || summary.constant_rgb;
+    return !m_varying_topology || !has_constant;
+}
+
+void aiPolyMesh::onSampleSwapped(Sample& current, Sample& previous)
+{
+    // a fill of the previous sample may still read the buffers taken below, and the sample is handed to the cache or
+    // the ring after this
+    previous.m_async_fill.wait();
+
+    // interpolated points of the last update are the base of computed velocities.
+    // a pinned sample may still be read, so its buffer is copied instead of taken
+    if (isPinned(previous))
+        current.m_points_int.assign(previous.m_points_int.begin(), previous.m_points_int.end());
+    else
+        current.m_points_int.swap(previous.m_points_int);
+
+    // the first sample built the shared topology. it must not be rebuilt when that sample comes back
+    if (!m_varying_topology)
+    {
+        current.m_topology_changed = false;
+    }
+    else
+    {
+        // report the change relative to the sample that was shown last
+        auto& c = *current.m_topology;
+        auto& p = *previous.m_topology;
+        current.m_topology_changed = &c != &p && !(c.m_counts_key == p.m_counts_key && c.m_indices_key == p.m_indices_key);
+    }
+}
+
+void aiPolyMesh::onSampleUpdated(Sample& sample, bool cooked)
+{
+    auto& summary = m_summary;
+    auto& keys = sample.m_keys;
+    auto& last = m_last_keys;
+    auto& dst = sample.m_unchanged;
+    float time_offset = m_current_time_offset;
+
+    if (!cooked && m_has_last_update)
+    {
+        dst.points = dst.velocities = dst.normals = dst.tangents = true;
+        dst.uv0 = dst.uv1 = dst.rgba = dst.rgb = true;
+    }
+    else if (!m_has_last_update || sample.m_topology_changed)
+    {
+        dst = aiMeshUnchangedFlags();
+    }
+    else
+    {
+        // interpolated values are the same if both ends are, or if both updates hold a pose
+        auto same = [&](bool constant, bool interpolate, const aiArrayKey& k, const aiArrayKey& k2, const aiArrayKey& l, const aiArrayKey& l2) {
+            if (constant)
+                return true;
+            if (!interpolate)
+                return k == l;
+            return (k == l && k2 == l2 && time_offset == m_last_time_offset) || (k == k2 && l == l2 && k == l);
+        };
+
+        dst.points = !summary.has_points ||
+            same(!m_constants->points.empty(), summary.interpolate_points, keys.points, keys.points2, last.points, last.points2);
+        if (summary.compute_velocities)
+            dst.velocities = dst.points && m_last_points_unchanged;
+        else
+            dst.velocities = !summary.has_velocities_prop ||
+                same(!m_constants->velocities.empty(), false, keys.velocities, keys.velocities, last.velocities, last.velocities);
+        if (summary.compute_normals)
+            dst.normals = dst.points;
+        else
+            dst.normals = !summary.has_normals_prop ||
+                same(!m_constants->normals.empty(), summary.interpolate_normals, keys.normals, keys.normals2, last.normals, last.normals2);
+        dst.uv0 = !summary.has_uv0_prop ||
+            same(!m_constants->uv0.empty(), summary.interpolate_uv0, keys.uv0, keys.uv02, last.uv0, last.uv02);
+        dst.uv1 = !summary.has_uv1_prop ||
+            same(!m_constants->uv1.empty(), summary.interpolate_uv1, keys.uv1, keys.uv12, last.uv1, last.uv12);
+        dst.rgba = !summary.has_rgba_prop ||
+            same(!m_constants->rgba.empty(), summary.interpolate_rgba, keys.rgba, keys.rgba2, last.rgba, last.rgba2);
+        dst.rgb = !summary.has_rgb_prop ||
+            same(!m_constants->rgb.empty(), summary.interpolate_rgb, keys.rgb, keys.rgb2, last.rgb, last.rgb2);
+        dst.tangents = !summary.compute_tangents || !m_constants->tangents.empty() ||
+            (dst.points && dst.normals && dst.uv0);
+    }
+
+    // a sample this update didn't cook may still hold buffers encoded for an earlier aiConfig::vertex_format
+    auto& format = getConfig().vertex_format;
+    auto& encoded = sample.m_encoded_format;
+    if (!cooked && (format.normals != encoded.normals || format.tangents != encoded.tangents ||
+        format.uv != encoded.uv || format.colors != encoded.colors))
+    {
+        aiMeshUnchangedFlags same;
+        same.normals = same.tangents = same.uv0 = same.uv1 = same.rgba = same.rgb = true;
+        encodeAttributes(sample, same);
+        dst.normals = dst.tangents = dst.uv0 = dst.uv1 = dst.rgba = dst.rgb = false;
+    }
+
+    m_last_keys = keys;
+    m_last_time_offset = time_offset;
+    m_last_points_unchanged = dst.points;
+    m_has_last_update = true;
+
+    updateDirtyRanges(sample);
+}
+
+// cooked data of an attribute. the source of fills and views. empty if the sample doesn't have it
+template<class T>
+static inline aiBufferView attribute_view(const IArray<T>& src)
+{
+    aiBufferView ret;
+    ret.data = src.data();
+    ret.count = (int)src.size();
+    ret.element_size = sizeof(T);
+    return ret;
+}
+
+static aiBufferView AttributeData(const aiPolyMeshSample& sample, int attribute)
+{
+    switch (attribute)
+    {
+    case FillPoints: return attribute_view(sample.m_points_ref);
+    case FillVelocities: return attribute_view(sample.m_velocities_ref);
+    case FillNormals: return attribute_view(sample.m_normals_ref);
+    case FillTangents: return attribute_view(sample.m_tangents_ref);
+    case FillUV0: return attribute_view(sample.m_uv0_ref);
+    case FillUV1: return attribute_view(sample.m_uv1_ref);
+    case FillRGBA: return attribute_view(sample.m_rgba_ref);
+    case FillRGB: return attribute_view(sample.m_rgb_ref);
+    }
+    return aiBufferView();
+}
+
+// elements in [begin, end) that differ between a and b, in bytes of size per element. empty if there are none
+static aiVertexRange DiffRange(const char *a, const char *b, size_t size, int begin, int end)
+{
+    // memcmp over blocks narrows down to the first and last difference much faster than comparing elements
+    const int block_size = 256;
+
+    aiVertexRange ret;
+    int first = begin;
+    for (; first < end; first += block_size)
+    {
+        int n = std::min(block_size, end - first);
+        if (memcmp(a + size * first, b + size * first, size * n) != 0)
+            break;
+    }
+    if (first >= end)
+        return ret;
+    while (memcmp(a + size * first, b + size * first, size) == 0)
+        ++first;
+
+    int last = end;
+    for (;;)
+    {
+        int n = std::min(block_size, last - first);
+        if (memcmp(a + size * (last - n), b + size * (last - n), size * n) != 0)
+            break;
+        last -= n;
+    }
+    while (memcmp(a + size * (last - 1), b + size * (last - 1), size) == 0)
+        --last;
+
+    ret.begin = first;
+    ret.end = last;
+    return ret;
+}
+
+static inline void MergeRange(aiVertexRange& dst, const aiVertexRange& v)
+{
+    if (v.begin >= v.end)
+        return;
+    if (dst.begin >= dst.end)
+    {
+        dst = v;
+    }
+    else
+    {
+        dst.begin = std::min(dst.begin, v.begin);
+        dst.end = std::max(dst.end, v.end);
+    }
+}
+
+void aiPolyMesh::updateDirtyRanges(aiPolyMeshSample& sample)
+{
+    // below this, comparing is cheaper than waking workers
+    const int min_parallel_vertices = 0x10000;
+
+    auto& splits = sample.m_topology->m_refiner.splits;
+    auto& unchanged = sample.m_unchanged;
+    int num_splits = (int)splits.size();
+    bool changed[aiVertexAttributeCount] = {
+        !unchanged.points, !unchanged.velocities, !unchanged.normals, !unchanged.tangents,
+        !unchanged.uv0, !unchanged.uv1, !unchanged.rgba, !unchanged.rgb,
+    };
+    bool narrow = getConfig().dirty_ranges;
+
+    // new topology invalidates everything filled before
+    bool whole = sample.m_topology_changed;
+    {
+        std::lock_guard<std::mutex> lock(m_dirty_mutex);
+        whole = whole || m_dirty_ranges.size() != splits.size();
+    }
+
+    // ranges are computed without the lock. fills of the previous sample can clear theirs meanwhile, and
+    // m_last_attributes is only touched by updates
+    RawVector<aiSplitDirtyRanges> dirty;
+    dirty.resize_zeroclear(num_splits);
+    std::vector<int> compare;
+    for (int ai = 0; ai < aiVertexAttributeCount; ++ai)
+    {
+        auto& last = m_last_attributes[ai];
+        if (!changed[ai] && !whole)
+            continue;
+
+        // compare with the last update if it had the same number of elements. otherwise the whole split is dirty
+        auto src = AttributeData(sample, ai);
+        size_t byte_size = (size_t)src.count * src.element_size;
+        if (narrow && src.data && last.size() == byte_size && !whole)
+        {
+            compare.push_back(ai);
+            continue;
+        }
+        for (int si = 0; si < num_splits; ++si)
+            dirty[si].ranges[ai].end = splits[si].vertex_count;
+        if (narrow && src.data)
+            last.assign((const char*)src.data, (const char*)src.data + byte_size);
+        else
+            last.clear();
+    }
+
+    // jobs of attributes and splits touch disjoint parts of m_last_attributes and dirty
+    int num_workers = (int)sample.m_points_ref.size() >= min_parallel_vertices ? getContext()->getWorkerCount() : 1;
+    if (!compare.empty())
+    {
+        aiParallelFor((int)compare.size() * num_splits, num_workers, [&](int ji) {
+            int ai = compare[ji / num_splits];
+            int si = ji % num_splits;
+            auto& split = splits[si];
+            auto src = AttributeData(sample, ai);
+            auto *cur = (const char*)src.data;
+            auto *last = m_last_attributes[ai].data();
+            size_t size = src.element_size;
+
+            auto diff = DiffRange(cur, last, size, split.vertex_offset, split.vertex_offset + split.vertex_count);
+            if (diff.begin < diff.end)
+            {
+                memcpy(last + size * diff.begin, cur + size * diff.begin, size * (diff.end - diff.begin));
+                diff.begin -= split.vertex_offset;
+                diff.end -= split.vertex_offset;
+                dirty[si].ranges[ai] = diff;
+            }
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(m_dirty_mutex);
+    m_dirty_sample = &sample;
+    if (whole)
+    {
+        m_dirty_ranges = dirty;
+    }
+    else
+    {
+        for (int si = 0; si < num_splits; ++si)
+        {
+            for (int ai = 0; ai < aiVertexAttributeCount; ++ai)
+                MergeRange(m_dirty_ranges[si].ranges[ai], dirty[si].ranges[ai]);
+        }
+    }
+}
+
+void aiPolyMesh::getDirtyRanges(const aiPolyMeshSample& sample, int split_index, aiSplitDirtyRanges& dst)
+{
+    std::lock_guard<std::mutex> lock(m_dirty_mutex);
+    if (&sample == m_dirty_sample && size_t(split_index) < m_dirty_ranges.size())
+    {
+        dst = m_dirty_ranges[split_index];
+    }
+    else
+    {
+        for (auto& r : dst.ranges)
+        {
+            r.begin = 0;
+            r.end = sample.m_topology->m_refiner.splits[split_index].vertex_count;
+        }
+    }
+}
+
+void aiPolyMesh::clearDirtyRanges(const aiPolyMeshSample& sample, int split_index, int attribute_mask)
+{
+    std::lock_guard<std::mutex> lock(m_dirty_mutex);
+    // a fill of an older sample doesn't have the changes of later updates
+    if (&sample != m_dirty_sample || size_t(split_index) >= m_dirty_ranges.size())
+        return;
+    for (int ai = 0; ai < aiVertexAttributeCount; ++ai)
+    {
+        if (attribute_mask & (1 << ai))
+            m_dirty_ranges[split_index].ranges[ai] = aiVertexRange();
+    }
+}
+
+std::string aiPolyMesh::getSharedKey() const
+{
+    // everything that changes the cooked topology or constant attributes
+    auto& config = getConfig();
+    std::ostringstream os;
+    os << "aiPolyMesh:" << getFullName()
+        << ':' << (int)config.normals_mode << ':' << (int)config.tangents_mode
+        << ':' << config.scale_factor << ':' << config.split_unit
+        << ':' << config.swap_handedness << config.swap_face_winding << config.interpolate_samples
+        << config.import_point_polygon << config.import_line_polygon << config.import_triangle_polygon
+        << config.hash_vertex_dedup << ':' << (int)config.index_format;
+    return os.str();
+}
+
+bool aiPolyMesh::adoptSharedConstants()
+{
+    auto *archive = getContext()->getSharedArchive();
+    if (!archive)
+        return false;
+
+    auto shared = archive->findShared<aiPolyMeshConstants>(getSharedKey());
+    if (!shared)
+        return false;
+
+    // the topology is already refined, so the first sample only remaps its attributes
+    m_constants = shared;
+    m_shared_topology = shared->topology;
+    m_constants_shared = true;
+    return true;
+}
+
+void aiPolyMesh::publishConstants()
+{
+    auto *archive = getContext()->getSharedArchive();
+    if (!archive || !m_shared_topology || m_shared_topology->m_vertex_count == 0)
+        return;
+
+    m_publish_constants = false;
+    m_constants->topology = m_shared_topology;
+    // if another context published first, this one keeps using its own copy
+    if (archive->publishShared(getSharedKey(), m_constants) == m_constants)
+        m_constants_shared = true;
+    else
+        m_constants->topology.reset();
+}
+
+void aiPolyMesh::detachSharedConstants(aiPolyMeshSample& sample)
+{
+    m_constants.reset(new aiPolyMeshConstants());
+    m_shared_topology.reset(new aiMeshTopology());
+    sample.m_topology = m_shared_topology;
+    m_constants_shared = false;
+}
+
+void aiPolyMesh::generatePointNormals(aiPolyMeshSample& sample, RawVector<abcV3>& dst)
+{
+    auto& topology = *sample.m_topology;
+    IArray<int> counts{ topology.m_counts_sp->get(), topology.m_counts_sp->size() };
+    IArray<int> indices{ topology.m_indices_sp->get(), topology.m_indices_sp->size() };
+    IArray<float3> points{ (float3*)sample.m_points_sp->get(), sample.m_points_sp->size() };
+
+    // the connection is built in onTopologyChange(). topologies refined before normals were computed lack it
+    const MeshConnectionInfo *connection = &topology.m_refiner.connection;
+    MeshConnectionInfo tmp;
+    if (connection->v2f_counts.size() != points.size())
+    {
+        tmp.buildConnection(indices, counts, points);
+        connection = &tmp;
+    }
+    GeneratePointNormals(*connection, counts, indices, points, topology.m_remap_points, (float3*)dst.data(),
+        getContext()->getWorkerCount());
+}
+
+void aiPolyMesh::updateSplitBounds(aiPolyMeshSample& sample, bool same_points)
+{
+    auto& config = getConfig();
+    auto& summary = getSummary();
+    auto& splits = sample.m_topology->m_refiner.splits;
+    auto& dst = sample.m_split_bounds;
+    int num_splits = (int)splits.size();
+
+    // bounds made by an earlier cook of this sample are still valid if its points and the mode are
+    bool constant_points = !m_constants->points.empty() && !summary.interpolate_points;
+    if ((int)dst.size() == num_splits && !sample.m_topology_changed && (same_points || constant_points) &&
+        sample.m_split_bounds_mode == config.bounds_mode)
+        return;
+
+    dst.resize_discard(num_splits);
+    sample.m_split_bounds_mode = config.bounds_mode;
+    auto& box = sample.m_bounds;
+    if (config.bounds_mode == aiBoundsMode::ArchiveIfPossible && num_splits == 1 && !summary.interpolate_points && !box.isEmpty())
+    {
+        // archive bounds are in the file's space. apply the same handedness flip and scale as points
+        float scale = config.scale_factor;
+        abcV3 bbmin{ (float)box.min.x * scale, (float)box.min.y * scale, (float)box.min.z * scale };
+        abcV3 bbmax{ (float)box.max.x * scale, (float)box.max.y * scale, (float)box.max.z * scale };
+        if (config.swap_handedness)
+        {
+            float x = bbmin.x;
+            bbmin.x = -bbmax.x;
+            bbmax.x = -x;
+        }
+        dst[0].center = (bbmin + bbmax) * 0.5f;
+        dst[0].extents = bbmax - bbmin;
+        return;
+    }
+
+    auto& points = sample.m_points_ref;
+    aiParallelFor(num_splits, getContext()->getWorkerCount(), [&](int spi) {
+        auto& split = splits[spi];
+        abcV3 bbmin{ 0.0f, 0.0f, 0.0f }, bbmax{ 0.0f, 0.0f, 0.0f };
+        if (split.vertex_count > 0 && (size_t)(split.vertex_offset + split.vertex_count) <= points.size())
+            MinMax(bbmin, bbmax, points.data() + split.vertex_offset, split.vertex_count);
+        dst[spi].center = (bbmin + bbmax) * 0.5f;
+        dst[spi].extents = bbmax - bbmin;
+    });
+}
+
+// constant attributes, and animated ones whose arrays were reused, are encoded once per sample and topology
+template<class Q, class T>
+static inline void EncodeAttribute(RawVector<Q>& dst, const IArray<T>& src, bool enabled, bool keep)
+{
+    if (!enabled || src.empty())
+    {
+        dst.clear();
+        return;
+    }
+    if (keep && dst.size() == src.size())
+        return;
+    dst.resize_discard(src.size());
+    Encode(dst.data(), src.data(), (int)src.size());
+}
+
+void aiPolyMesh::encodeAttributes(aiPolyMeshSample& sample, const aiMeshUnchangedFlags& same)
+{
+    auto& format = getConfig().vertex_format;
+    auto& encoded = sample.m_encoded_format;
+    auto& constants = *m_constants;
+    bool keep = !sample.m_topology_changed;
+
+    // buffers made for another format are encoded again
+    EncodeAttribute(sample.m_normals_q, sample.m_normals_ref, format.normals == aiAttributeFormat::Oct16,
+        keep && format.normals == encoded.normals && (!constants.normals.empty() || same.normals));
+    EncodeAttribute(sample.m_tangents_q, sample.m_tangents_ref, format.tangents == aiAttributeFormat::Oct16,
+        keep && format.tangents == encoded.tangents && (!constants.tangents.empty() || same.tangents));
+    EncodeAttribute(sample.m_uv0_q, sample.m_uv0_ref, format.uv == aiAttributeFormat::Half16,
+        keep && format.uv == encoded.uv && (!constants.uv0.empty() || same.uv0));
+    EncodeAttribute(sample.m_uv1_q, sample.m_uv1_ref, format.uv == aiAttributeFormat::Half16,
+        keep && format.uv == encoded.uv && (!constants.uv1.empty() || same.uv1));
+    EncodeAttribute(sample.m_rgba_q, sample.m_rgba_ref, format.colors == aiAttributeFormat::UNorm8,
+        keep && format.colors == encoded.colors && (!constants.rgba.empty() || same.rgba));
+    EncodeAttribute(sample.m_rgb_q, sample.m_rgb_ref, format.colors == aiAttributeFormat::UNorm8,
+        keep && format.colors == encoded.colors && (!constants.rgb.empty() || same.rgb));
+    encoded = format;
+}
+
 void aiPolyMesh::onTopologyDetermined()
 {
     // nothing to do for now
@@ -25,6 +25,17 @@ struct aiMeshSummaryInternal : public aiMeshSummary
     bool compute_velocities = false;
 };
 
+// identifies the array samples an attribute buffer was read from. equal keys mean identical data
+struct aiArrayKey
+{
+    abcArraySampleKey values{}, indices{};
+    bool valid = false;
+    bool reused = false; // the last read found the same array samples already held and skipped them
+
+    bool operator==(const aiArrayKey& v) const { return valid && v.valid && values == v.values && indices == v.indices; }
+    bool operator!=(const aiArrayKey& v) const { return !(*this == v); }
+};
+
 class aiMeshTopology
 {
 public:
@@ -38,10 +49,12 @@ public:
     int getSplitVertexCount(int split_index) const;
     int getSubmeshCount() const;
     int getSubmeshCount(int split_index) const;
+    size_t getByteSize() const;
 
 public:
     Abc::Int32ArraySamplePtr m_indices_sp;
     Abc::Int32ArraySamplePtr m_counts_sp;
+    aiArrayKey m_indices_key, m_counts_key;
     abcFaceSetSamples m_faceset_sps;
     RawVector<int> m_material_ids;
 
@@ -57,6 +70,61 @@ public:
 };
 using TopologyPtr = std::shared_ptr<aiMeshTopology>;
 
+// cooked data that doesn't change over time.
+// with constant topology, it is shared with other contexts that loaded the same archive once the first cook is done.
+struct aiPolyMeshConstants
+{
+    TopologyPtr topology; // set when shared
+    RawVector<abcV3> points;
+    RawVector<abcV3> velocities;
+    RawVector<abcV3> normals;
+    RawVector<abcV4> tangents;
+    RawVector<abcV2> uv0;
+    RawVector<abcV2> uv1;
+    RawVector<abcC4> rgba;
+    RawVector<abcC3> rgb;
+};
+using aiPolyMeshConstantsPtr = std::shared_ptr<aiPolyMeshConstants>;
+
+
+struct aiMeshSampleKeys
+{
+    aiArrayKey points, points2;
+    aiArrayKey velocities;
+    aiArrayKey normals, normals2;
+    aiArrayKey uv0, uv02;
+    aiArrayKey uv1, uv12;
+    aiArrayKey rgba, rgba2;
+    aiArrayKey rgb, rgb2;
+};
+
+// attributes whose data is the same as the previous update
+struct aiMeshUnchangedFlags
+{
+    bool points = false;
+    bool velocities = false;
+    bool normals = false;
+    bool tangents = false;
+    bool uv0 = false;
+    bool uv1 = false;
+    bool rgba = false;
+    bool rgb = false;
+};
+
+const int aiVertexAttributeCount = (int)aiVertexAttribute::RGB + 1;
+
+// vertices of a split changed since the last fill, indexed by aiVertexAttribute
+struct aiSplitDirtyRanges
+{
+    aiVertexRange ranges[aiVertexAttributeCount];
+};
+
+
+struct aiSplitBounds
+{
+    abcV3 center;
+    abcV3 extents;
+};
 
 class aiPolyMeshSample : public aiSample
 {
@@ -70,10 +138,25 @@ public:
     void getSummary(aiMeshSampleSummary &dst) const;
     void getSplitSummaries(aiMeshSplitSummary  *dst) const;
     void getSubmeshSummaries(aiSubmeshSummary *dst) const;
+    void getSplitDirtySummaries(aiMeshSplitDirtySummary *dst) const;
 
     void fillSplitVertices(int split_index, aiPolyMeshData &data) const;
+    void fillSplitAttribute(int split_index, int attribute, aiPolyMeshData &data) const;
+    void fillSplitStream(int split_index, aiVertexStreamData& data) const;
     void fillSubmeshIndices(int submesh_index, aiSubmeshData &data) const;
     void fillVertexBuffer(aiPolyMeshData* vbs, aiSubmeshData* ibs);
+    // vbs and ibs must stay valid until the returned task is completed
+    aiAsyncTask* fillVertexBufferAsync(aiPolyMeshData* vbs, aiSubmeshData* ibs);
+    // point into the cooked buffers. valid while the sample is pinned
+    void getSplitView(int split_index, aiPolyMeshSplitView& dst) const;
+    void getSubmeshView(int submesh_index, aiBufferView& dst) const;
+    size_t getByteSize() const override;
+
+protected:
+    void getSplitBounds(int split_index, abcV3& center, abcV3& extents) const;
+    void fillStreamElement(const aiVertexElement& e, char *dst, int first, int num) const;
+    // attribute_mask: bits of aiVertexAttribute the fill wrote
+    void markFilled(int split_index, int attribute_mask) const;
 
 public:
     Abc::P3fArraySamplePtr m_points_sp, m_points_sp2;
@@ -101,11 +184,21 @@ public:
     RawVector<abcV4> m_tangents;
     RawVector<abcC4> m_rgba, m_rgba2, m_rgba_int;
     RawVector<abcC3> m_rgb, m_rgb2, m_rgb_int;
+    // encoded attributes for aiConfig::vertex_format
+    RawVector<snorm16x2> m_normals_q;
+    RawVector<snorm16x4> m_tangents_q;
+    RawVector<half16x2> m_uv0_q, m_uv1_q;
+    RawVector<unorm8x4> m_rgba_q, m_rgb_q;
+    aiVertexFormat m_encoded_format; // format the buffers above were made with
+    RawVector<aiSplitBounds> m_split_bounds; // per split. made by cook unless aiBoundsMode::ComputeOnFill
+    aiBoundsMode m_split_bounds_mode = aiBoundsMode::ComputeOnCook; // mode m_split_bounds were made with
 
     TopologyPtr m_topology;
     bool m_topology_changed = false;
+    aiMeshSampleKeys m_keys;
+    aiMeshUnchangedFlags m_unchanged;
 
-    std::future<void> m_async_copy;
+    aiAsyncTask m_async_fill; // fillVertexBufferAsync(). waited before the sample is read or cooked again
 };
 
 
@@ -125,21 +218,33 @@ public:
     const aiMeshSummaryInternal& getSummary() const;
 
     Sample* newSample() override;
-    void readSampleBody(Sample& sample, uint64_t idx) override;
-    void cookSampleBody(Sample& sample) override;
+    void readSampleBody(Sample& sample, uint64_t idx, bool force_update) override;
+    void cookSampleBody(Sample& sample, bool index_changed, float time_offset) override;
 
     void onTopologyChange(aiPolyMeshSample& sample);
     void onTopologyDetermined();
 
+    // dirty ranges are relative to the current sample. others are reported as entirely dirty
+    void getDirtyRanges(const aiPolyMeshSample& sample, int split_index, aiSplitDirtyRanges& dst);
+    void clearDirtyRanges(const aiPolyMeshSample& sample, int split_index, int attribute_mask);
+
+protected:
+    bool canHoldMultipleSamples() const override;
+    void onSampleSwapped(Sample& current, Sample& previous) override;
+    void onSampleUpdated(Sample& sample, bool cooked) override;
+
+    bool isSameTopology(const aiMeshTopology& topology, const abcSampleSelector& ss) const;
+    void generatePointNormals(aiPolyMeshSample& sample, RawVector<abcV3>& dst);
+    void updateSplitBounds(aiPolyMeshSample& sample, bool same_points);
+    void encodeAttributes(aiPolyMeshSample& sample, const aiMeshUnchangedFlags& same);
+    void updateDirtyRanges(aiPolyMeshSample& sample);
+    std::string getSharedKey() const;
+    bool adoptSharedConstants();
+    void publishConstants();
+    void detachSharedConstants(aiPolyMeshSample& sample);
+
 public:
-    RawVector<abcV3> m_constant_points;
-    RawVector<abcV3> m_constant_velocities;
-    RawVector<abcV3> m_constant_normals;
-    RawVector<abcV4> m_constant_tangents;
-    RawVector<abcV2> m_constant_uv0;
-    RawVector<abcV2> m_constant_uv1;
-    RawVector<abcC4> m_constant_rgba;
-    RawVector<abcC3> m_constant_rgb;
+    aiPolyMeshConstantsPtr m_constants;
 
 private:
     aiMeshSummaryInternal m_summary;
@@ -148,6 +253,22 @@ private:
     AbcGeom::IC3fGeomParam m_rgb_param;
 
     TopologyPtr m_shared_topology;
+    TopologyPtr m_last_topology; // heterogeneous topology read last. can be shared by samples with the same topology
+    std::mutex m_last_topology_mutex;
     abcFaceSetSchemas m_facesets;
     bool m_varying_topology = false;
+    bool m_constants_shared = false; // m_constants is registered in the archive and must not be modified
+    bool m_publish_constants = false;
+
+    // what the previous update returned. to tell which attributes changed
+    aiMeshSampleKeys m_last_keys;
+    float m_last_time_offset = 0.0f;
+    bool m_last_points_unchanged = false;
+    bool m_has_last_update = false;
+
+    // attributes changed since the last fill, per split. accumulated by updates and cleared by fills
+    RawVector<aiSplitDirtyRanges> m_dirty_ranges;
+    const aiPolyMeshSample *m_dirty_sample = nullptr; // the sample m_dirty_ranges is relative to
+    RawVector<char> m_last_attributes[aiVertexAttributeCount]; // cooked data of the last update. for aiConfig::dirty_ranges
+    std::mutex m_dirty_mutex;
 };
@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "aiInternal.h"
+#include "aiContext.h"
+#include "aiObject.h"
+#include "aiSchema.h"
+#include "aiSampleCache.h"
+
+
+void aiSampleCache::setBudget(size_t bytes)
+{
+    std::vector<SamplePtr> dropped;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    evict(m_budget, dropped);
+}
+
+bool aiSampleCache::enabled() const
+{
+    return m_budget > 0;
+}
+
+aiSampleCache::SamplePtr aiSampleCache::take(const aiSchema *schema, int64_t index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_table.find(Key(schema, index));
+    if (it == m_table.end())
+    {
+        ++m_miss_count;
+        return nullptr;
+    }
+
+    ++m_hit_count;
+    auto ret = std::move(it->second->sample);
+    m_size -= it->second->size;
+    m_entries.erase(it->second);
+    m_table.erase(it);
+    return ret;
+}
+
+void aiSampleCache::put(const aiSchema *schema, int64_t index, SamplePtr sample)
+{
+    if (!sample)
+        return;
+
+    // dropped samples are destroyed after unlocking. their destructors can wait for tasks, and waiting helps the pool
+    // run other tasks that may put() too
+    std::vector<SamplePtr> dropped;
+    size_t size = sample->getByteSize();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (size > m_budget)
+    {
+        dropped.push_back(std::move(sample));
+        return;
+    }
+
+    Key key(schema, index);
+    auto it = m_table.find(key);
+    if (it != m_table.end())
+    {
+        m_size -= it->second->size;
+        dropped.push_back(std::move(it->second->sample));
+        m_entries.erase(it->second);
+        m_table.erase(it);
+    }
+
+    evict(m_budget - size, dropped);
+    m_entries.push_front({ key, std::move(sample), size });
+    m_table[key] = m_entries.begin();
+    m_size += size;
+}
+
+bool aiSampleCache::contains(const aiSchema *schema, int64_t index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_table.find(Key(schema, index)) != m_table.end();
+}
+
+void aiSampleCache::erase(const aiSchema *schema)
+{
+    std::vector<SamplePtr> dropped;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_table.lower_bound(Key(schema, std::numeric_limits<int64_t>::min()));
+    while (it != m_table.end() && it->first.first == schema)
+    {
+        m_size -= it->second->size;
+        dropped.push_back(std::move(it->second->sample));
+        m_entries.erase(it->second);
+        it = m_table.erase(it);
+    }
+}
+
+void aiSampleCache::clear()
+{
+    EntryList dropped;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    dropped.swap(m_entries);
+    m_table.clear();
+    m_size = 0;
+}
+
+void aiSampleCache::getStats(aiSampleCacheStats& dst)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    dst.hit_count = m_hit_count;
+    dst.miss_count = m_miss_count;
+    dst.byte_size = m_size;
+    dst.entry_count = (int)m_entries.size();
+}
+
+void aiSampleCache::evict(size_t budget, std::vector<SamplePtr>& dropped)
+{
+    while (m_size > budget && !m_entries.empty())
+    {
+        auto& last = m_entries.back();
+        m_size -= last.size;
+        m_table.erase(last.key);
+        dropped.push_back(std::move(last.sample));
+        m_entries.pop_back();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <list>
+
+// cooked samples of recently shown sample indices, shared by all schemas of a context.
+// a sample lives either here or in its schema: take() moves it out, put() moves it in.
+// least recently put samples are dropped when the total size exceeds the budget.
+class aiSampleCache
+{
+public:
+    using SamplePtr = std::shared_ptr<aiSample>;
+
+    void setBudget(size_t bytes);
+    bool enabled() const;
+
+    SamplePtr take(const aiSchema *schema, int64_t index);
+    void put(const aiSchema *schema, int64_t index, SamplePtr sample);
+    bool contains(const aiSchema *schema, int64_t index);
+    void erase(const aiSchema *schema);
+    void clear();
+
+    void getStats(aiSampleCacheStats& dst);
+
+private:
+    using Key = std::pair<const aiSchema*, int64_t>;
+    struct Entry
+    {
+        Key key;
+        SamplePtr sample;
+        size_t size;
+    };
+    using EntryList = std::list<Entry>;
+
+    // evicted samples are moved to dropped, to be destroyed after unlocking
+    void evict(size_t budget, std::vector<SamplePtr>& dropped);
+
+    EntryList m_entries; // front is the most recent
+    std::map<Key, EntryList::iterator> m_table;
+    size_t m_budget = 0;
+    size_t m_size = 0;
+    uint64_t m_hit_count = 0;
+    uint64_t m_miss_count = 0;
+    std::mutex m_mutex; // schemas are updated in parallel
+};
@@ -32,7 +32,12 @@ aiSchema::~aiSchema()
 
 bool aiSchema::isConstant() const { return m_constant; }
 bool aiSchema::isDataUpdated() const { return m_data_updated; }
-void aiSchema::markForceUpdate() { m_force_update = true; }
+
+void aiSchema::markForceUpdate()
+{
+    getContext()->waitPrefetch();
+    m_force_update = true;
+}
 
 int aiSchema::getNumProperties() const
 {
@@ -1,5 +1,6 @@
 #pragma once
 #include "aiAsync.h"
+#include "../Foundation/aiThreadPool.h"
 
 
 class aiSample
@@ -10,9 +11,12 @@ public:
 
     virtual aiSchema* getSchema() const { return m_schema; }
     const aiConfig& getConfig() const;
+    // memory held by cooked data. used to keep aiSampleCache under budget
+    virtual size_t getByteSize() const { return 0; }
 
 public:
     bool visibility = true;
+    int m_pin_count = 0; // aiTSchema::pinSample(). a pinned sample is not read or cooked into until released
 
 protected:
     aiSchema *m_schema = nullptr;
@@ -110,15 +114,100 @@ public:
             getContext()->queueAsync(m_async_load);
     }
 
-    virtual void readSample(Sample& sample, uint64_t idx)
+    // samples can be read and cooked on prefetch workers. everything that depends on the update is passed in
+    virtual void readSample(Sample& sample, uint64_t idx, bool force_update)
     {
-        m_force_update_local = m_force_update;
-        readSampleBody(sample, idx);
+        readSampleBody(sample, idx, force_update);
     }
 
-    virtual void cookSample(Sample& sample)
+    virtual void cookSample(Sample& sample, bool index_changed, float time_offset)
     {
-        cookSampleBody(sample);
+        cookSampleBody(sample, index_changed, time_offset);
+    }
+
+    // keeps the current sample and the buffers it refers to as they are until releaseSample().
+    // updates meanwhile continue on another sample. returns nullptr if there is no sample yet
+    Sample* pinSample()
+    {
+        std::lock_guard<std::mutex> lock(m_pin_mutex);
+        if (!m_sample)
+            return nullptr;
+        if (m_sample->m_pin_count++ == 0)
+            m_pinned_samples.push_back(m_sample);
+        return m_sample.get();
+    }
+
+    void releaseSample(Sample *sample)
+    {
+        std::lock_guard<std::mutex> lock(m_pin_mutex);
+        auto it = std::find_if(m_pinned_samples.begin(), m_pinned_samples.end(),
+            [sample](const SamplePtr& s) { return s.get() == sample; });
+        if (it != m_pinned_samples.end() && --(*it)->m_pin_count == 0)
+            m_pinned_samples.erase(it); // frees the sample if an update has replaced it meanwhile
+    }
+
+    void prefetchSamples(double time, double step, aiTaskGroup& tasks, const std::atomic<bool>& cancel) override
+    {
+        int capacity = getConfig().prefetch_count;
+        if (!m_enabled || m_constant || !m_sample || capacity <= 0 || !canHoldMultipleSamples())
+        {
+            m_prefetch_slots.clear();
+            return;
+        }
+
+        // sample indices the next updates will most likely request, nearest first.
+        // with small steps several updates map to the same index, so look further ahead than capacity.
+        auto& cache = getContext()->getSampleCache();
+        std::vector<int64_t> indices;
+        for (int k = 1; (int)indices.size() < capacity && k <= capacity * 64; ++k)
+        {
+            int64_t idx = getSampleIndex(aiTimeToSampleSelector(time + step * k));
+            if (idx != m_last_sample_index && std::find(indices.begin(), indices.end(), idx) == indices.end() &&
+                !(cache.enabled() && cache.contains(this, idx)))
+                indices.push_back(idx);
+        }
+
+        // recycle slots that are not wanted anymore
+        m_prefetch_slots.resize(capacity);
+        for (auto& slot : m_prefetch_slots)
+        {
+            if (std::find(indices.begin(), indices.end(), slot.index) == indices.end())
+            {
+                slot.index = -1;
+                slot.ready = false;
+            }
+        }
+
+        std::vector<PrefetchSlot*> jobs;
+        for (auto idx : indices)
+        {
+            auto it = std::find_if(m_prefetch_slots.begin(), m_prefetch_slots.end(),
+                [idx](const PrefetchSlot& s) { return s.index == idx; });
+            if (it == m_prefetch_slots.end())
+                it = std::find_if(m_prefetch_slots.begin(), m_prefetch_slots.end(),
+                    [](const PrefetchSlot& s) { return s.index == -1; });
+            if (it == m_prefetch_slots.end() || it->ready)
+                continue;
+            it->index = idx;
+            jobs.push_back(&*it);
+        }
+        if (jobs.empty())
+            return;
+
+        // samples of one schema are read in order by one task. tasks of other schemas run in parallel.
+        // workers must not read schema state the main thread writes. anything they need is captured here
+        bool force_update = m_force_update;
+        tasks.run([this, jobs, force_update, &cancel]() {
+            for (auto *slot : jobs)
+            {
+                if (cancel)
+                    break;
+                if (!slot->sample)
+                    slot->sample.reset(newSample());
+                prefetchSample(*slot->sample, slot->index, force_update);
+                slot->ready = true;
+            }
+        });
     }
 
 
@@ -132,13 +221,48 @@ protected:
         int64_t sample_index = getSampleIndex(ss);
         auto& config = getConfig();
 
-        if (!m_sample || (!m_constant && sample_index != m_last_sample_index) || m_force_update)
+        auto& cache = getContext()->getSampleCache();
+        if (m_force_update)
+        {
+            m_prefetch_slots.clear();
+            cache.erase(this);
+        }
+
+        bool index_changed = m_sample && !m_constant && sample_index != m_last_sample_index;
+
+        // an update that may write to a pinned sample continues on a new one. a forced update rebuilds state
+        // the pinned sample shares (e.g. topology), and some schemas can't hold two samples. those wait for the release
+        bool detach = m_sample && isPinned(*m_sample) &&
+            (index_changed || m_force_update || (config.interpolate_samples && !m_constant));
+        if (detach && (m_force_update || !canHoldMultipleSamples()))
+        {
+            m_data_updated = false;
+            return;
+        }
+
+        if (index_changed && !m_force_update && takeCookedSample(sample_index))
+        {
+            // already cooked, either in the background or on an earlier visit. only the interpolation stage is left
+            m_sample_index_changed = false;
+            sample = m_sample.get();
+        }
+        else if (!m_sample || index_changed || m_force_update || detach)
         {
             m_sample_index_changed = true;
+            if (detach || (index_changed && !m_force_update && cache.enabled() && canHoldMultipleSamples()))
+            {
+                // keep the current sample for later visits and cook the new index into another one.
+                // a pinned sample is left to the pin
+                SamplePtr prev = std::move(m_sample);
+                m_sample.reset(newSample());
+                onSampleSwapped(*m_sample, *prev);
+                if (!detach)
+                    cache.put(this, m_last_sample_index, std::move(prev));
+            }
             if (!m_sample)
                 m_sample.reset(newSample());
             sample = m_sample.get();
-            readSample(*sample, sample_index);
+            readSample(*sample, sample_index, m_force_update);
         }
         else
         {
@@ -169,28 +293,85 @@ protected:
                 (float)std::max(0.0, std::min((requested_time - index_time) / interval, 1.0));
             m_current_time_interval = (float)interval;
 
-            // skip if time offset is not changed
-            if (sample_index == m_last_sample_index && prev_offset == m_current_time_offset && !m_force_update)
+            // skip if time offset is not changed. a sample that replaced a pinned one is not cooked yet
+            if (sample_index == m_last_sample_index && prev_offset == m_current_time_offset && !m_force_update && !detach)
                 sample = nullptr;
         }
 
         if (sample) {
 
-            cookSample(*sample);
+            cookSample(*sample, m_sample_index_changed, m_current_time_offset);
             m_data_updated = true;
         }
         else
         {
             m_data_updated = false;
         }
+        if (m_sample)
+            onSampleUpdated(*m_sample, sample != nullptr);
         updateProperties(ss);
 
         m_last_sample_index = sample_index;
         m_force_update = false;
     }
 
-    virtual void readSampleBody(Sample& sample, uint64_t idx) = 0;
-    virtual void cookSampleBody(Sample& sample) = 0;
+    virtual void readSampleBody(Sample& sample, uint64_t idx, bool force_update) = 0;
+    virtual void cookSampleBody(Sample& sample, bool index_changed, float time_offset) = 0;
+
+    // prefetch and sample cache are opt-in. schemas that support them make sure cooking another sample doesn't
+    // touch state the current sample depends on.
+    virtual bool canHoldMultipleSamples() const { return false; }
+    // called when a prefetched sample replaces current. carry over states that span samples (e.g. velocity history)
+    virtual void onSampleSwapped(Sample& current, Sample& previous) {}
+    // called at the end of every update with the current sample. cooked is false if the update changed nothing
+    virtual void onSampleUpdated(Sample& sample, bool cooked) {}
+
+    void prefetchSample(Sample& sample, int64_t idx, bool force_update)
+    {
+        readSample(sample, idx, force_update);
+
+        // cook as if the sample index just changed. the interpolation stage is done again when the sample is taken
+        cookSample(sample, true, 0.0f);
+    }
+
+    // make the sample of idx current if it is in the prefetch ring or in the sample cache
+    bool takeCookedSample(int64_t idx)
+    {
+        if (!canHoldMultipleSamples())
+        {
+            m_prefetch_slots.clear();
+            return false;
+        }
+
+        auto& cache = getContext()->getSampleCache();
+        SamplePtr next;
+        auto slot = std::find_if(m_prefetch_slots.begin(), m_prefetch_slots.end(),
+            [idx](const PrefetchSlot& s) { return s.index == idx && s.ready; });
+        if (slot != m_prefetch_slots.end())
+        {
+            next = std::move(slot->sample);
+            slot->index = -1;
+            slot->ready = false;
+        }
+        else if (cache.enabled())
+        {
+            next = std::static_pointer_cast<Sample>(cache.take(this, idx));
+        }
+        if (!next)
+            return false;
+
+        onSampleSwapped(*next, *m_sample);
+        // the previous sample goes to the cache, or back to the ring to be reused for upcoming samples.
+        // a pinned one is left to the pin
+        if (isPinned(*m_sample))
+            m_sample.reset();
+        else if (cache.enabled())
+            cache.put(this, m_last_sample_index, std::move(m_sample));
+        else if (slot != m_prefetch_slots.end())
+            slot->sample = std::move(m_sample);
+        m_sample = std::move(next);
+        return true;
+    }
 
 
     AbcGeom::ICompoundProperty getAbcProperties() override
@@ -198,6 +379,12 @@ protected:
         return m_schema.getUserProperties();
     }
 
+    bool isPinned(const Sample& sample)
+    {
+        std::lock_guard<std::mutex> lock(m_pin_mutex);
+        return sample.m_pin_count > 0;
+    }
+
     void readVisibility(Sample& sample, const abcSampleSelector& ss)
     {
         if (m_visibility_prop.valid() && m_visibility_prop.getNumSamples() > 0)
@@ -219,8 +406,16 @@ protected:
     float m_current_time_interval = 0;
     bool m_sample_index_changed = false;
 
-    bool m_force_update_local = false; // m_force_update for worker thread
-
 private:
+    struct PrefetchSlot
+    {
+        int64_t index = -1;
+        SamplePtr sample;
+        bool ready = false;
+    };
+    std::vector<PrefetchSlot> m_prefetch_slots; // ring of read ahead samples. sized by aiConfig::prefetch_count
+    std::vector<SamplePtr> m_pinned_samples; // keeps pinned samples alive after updates replaced them
+    std::mutex m_pin_mutex;
+
     aiAsyncLoad m_async_load;
 };
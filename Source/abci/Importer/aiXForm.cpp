@@ -26,7 +26,7 @@ aiXform::Sample* aiXform::newSample()
     return new Sample(this);
 }
 
-void aiXform::readSampleBody(Sample& sample, uint64_t idx)
+void aiXform::readSampleBody(Sample& sample, uint64_t idx, bool force_update)
 {
     auto ss = aiIndexToSampleSelector(idx);
     auto ss2 = aiIndexToSampleSelector(idx + 1);
@@ -36,7 +36,7 @@ void aiXform::readSampleBody(Sample& sample, uint64_t idx)
     m_schema.get(sample.xf_sp2, ss2);
 }
 
-void aiXform::cookSampleBody(Sample& sample)
+void aiXform::cookSampleBody(Sample& sample, bool index_changed, float time_offset)
 {
     auto& config = getConfig();
 
@@ -46,15 +46,15 @@ void aiXform::cookSampleBody(Sample& sample)
     Imath::V3d trans;
     decompose(sample.xf_sp.getMatrix(), scale, shear, rot, trans);
 
-    if (config.interpolate_samples && m_current_time_offset != 0)
+    if (config.interpolate_samples && time_offset != 0)
     {
         Imath::V3d scale2;
         Imath::Quatd rot2;
         Imath::V3d trans2;
         decompose(sample.xf_sp2.getMatrix(), scale2, shear, rot2, trans2);
-        scale += (scale2 - scale) * m_current_time_offset;
-        trans += (trans2 - trans) * m_current_time_offset;
-        rot = Imath::slerpShortestArc(rot, rot2, (double)m_current_time_offset);
+        scale += (scale2 - scale) * time_offset;
+        trans += (trans2 - trans) * time_offset;
+        rot = Imath::slerpShortestArc(rot, rot2, (double)time_offset);
     }
 
     auto rot_final = abcV4(
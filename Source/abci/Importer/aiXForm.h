@@ -27,7 +27,7 @@ public:
     aiXform(aiObject *parent, const abcObject &abc);
 
     Sample* newSample() override;
-    void readSampleBody(Sample& sample, uint64_t idx) override;
-    void cookSampleBody(Sample& sample) override;
+    void readSampleBody(Sample& sample, uint64_t idx, bool force_update) override;
+    void cookSampleBody(Sample& sample, bool index_changed, float time_offset) override;
     void decompose(const Imath::M44d &mat, Imath::V3d &scale, Imath::V3d &shear, Imath::Quatd &rotation, Imath::V3d &translation) const;
 };
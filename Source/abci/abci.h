@@ -26,6 +26,7 @@
 struct abcV2 { float x, y; };
 struct abcV3 { float x, y, z; };
 struct abcV4 { float x, y, z, w; };
+using abcC3 = abcV3;
 using abcC4 = abcV4;
 
 struct abcSampleSelector
@@ -6,6 +6,7 @@
 #include <deque>
 #include <memory>
 #include <thread>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <future>
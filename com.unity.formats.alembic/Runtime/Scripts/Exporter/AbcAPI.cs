@@ -368,6 +368,7 @@ namespace UnityEngine.Formats.Alembic.Sdk
 
 
         [DllImport(Abci.Lib, BestFitMapping = false, ThrowOnUnmappableChar = true)] public static extern void aiClearContextsWithPath(string path);
+        [DllImport(Abci.Lib)] public static extern Bool aiSetThreadPoolConfig(ref aiThreadPoolConfig conf);
         [DllImport(Abci.Lib)] public static extern aiContext aiContextCreate(int uid);
         [DllImport(Abci.Lib)] public static extern void aiContextDestroy(IntPtr ctx);
         [DllImport(Abci.Lib, BestFitMapping = false, ThrowOnUnmappableChar = true)] public static extern Bool aiContextLoad(IntPtr ctx, string path);
@@ -377,7 +378,9 @@ namespace UnityEngine.Formats.Alembic.Sdk
         [DllImport(Abci.Lib)] public static extern aiTimeSampling aiContextGetTimeSampling(IntPtr ctx, int i);
         [DllImport(Abci.Lib)] public static extern void aiContextGetTimeRange(IntPtr ctx, out double begin, out double end);
         [DllImport(Abci.Lib)] public static extern aiObject aiContextGetTopObject(IntPtr ctx);
+        [DllImport(Abci.Lib, BestFitMapping = false, ThrowOnUnmappableChar = true)] public static extern aiObject aiContextFindObject(IntPtr ctx, string path);
         [DllImport(Abci.Lib)] public static extern void aiContextUpdateSamples(IntPtr ctx, double time);
+        [DllImport(Abci.Lib)] public static extern void aiContextGetSampleCacheStats(IntPtr ctx, ref aiSampleCacheStats dst);
 
         [DllImport(Abci.Lib)] public static extern int aiTimeSamplingGetSampleCount(IntPtr self);
         [DllImport(Abci.Lib)] public static extern double aiTimeSamplingGetTime(IntPtr self, int index);
@@ -418,7 +421,16 @@ namespace UnityEngine.Formats.Alembic.Sdk
         [DllImport(Abci.Lib)] public static extern void aiPolyMeshGetSampleSummary(IntPtr sample, ref aiMeshSampleSummary dst);
         [DllImport(Abci.Lib)] public static extern int aiPolyMeshGetSplitSummaries(IntPtr sample, IntPtr dst);
         [DllImport(Abci.Lib)] public static extern void aiPolyMeshGetSubmeshSummaries(IntPtr sample, IntPtr dst);
+        [DllImport(Abci.Lib)] public static extern void aiPolyMeshGetSplitDirtySummaries(IntPtr sample, IntPtr dst);
         [DllImport(Abci.Lib)] public static extern void aiPolyMeshFillVertexBuffer(IntPtr sample, IntPtr vbs, IntPtr ibs);
+        [DllImport(Abci.Lib)] public static extern void aiPolyMeshFillSplitStream(IntPtr sample, int splitIndex, ref aiVertexStreamData dst);
+        [DllImport(Abci.Lib)] public static extern IntPtr aiPolyMeshFillVertexBufferAsync(IntPtr sample, IntPtr vbs, IntPtr ibs);
+        [DllImport(Abci.Lib)] public static extern Bool aiAsyncTaskIsCompleted(IntPtr task);
+        [DllImport(Abci.Lib)] public static extern void aiAsyncTaskWait(IntPtr task);
+        [DllImport(Abci.Lib)] public static extern aiPolyMeshSample aiPolyMeshPinSample(IntPtr schema);
+        [DllImport(Abci.Lib)] public static extern void aiPolyMeshReleaseSample(IntPtr schema, IntPtr sample);
+        [DllImport(Abci.Lib)] public static extern void aiPolyMeshGetSplitView(IntPtr sample, int splitIndex, ref aiPolyMeshSplitView dst);
+        [DllImport(Abci.Lib)] public static extern void aiPolyMeshGetSubmeshView(IntPtr sample, int submeshIndex, ref aiBufferView dst);
 
         [DllImport(Abci.Lib)] public static extern void aiPointsGetSampleSummary(IntPtr sample, ref aiPointsSampleSummary dst);
         [DllImport(Abci.Lib)] public static extern void aiPointsFillData(IntPtr sample, IntPtr dst);
@@ -46,6 +46,44 @@ namespace UnityEngine.Formats.Alembic.Sdk
         Calculate,
     }
 
+    enum aiBoundsMode
+    {
+        ComputeOnFill,
+        ComputeOnCook,
+        ArchiveIfPossible,
+    }
+
+    enum aiIndexFormat
+    {
+        UInt32,
+        UInt16IfPossible,
+    }
+
+    enum aiAttributeFormat
+    {
+        Float32,
+        Oct16,
+        Half16,
+        UNorm8,
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct aiVertexFormat
+    {
+        public aiAttributeFormat normals { get; set; }
+        public aiAttributeFormat tangents { get; set; }
+        public aiAttributeFormat uv { get; set; }
+        public aiAttributeFormat colors { get; set; }
+
+        public void SetDefaults()
+        {
+            normals = aiAttributeFormat.Float32;
+            tangents = aiAttributeFormat.Float32;
+            uv = aiAttributeFormat.Float32;
+            colors = aiAttributeFormat.Float32;
+        }
+    }
+
     enum aiTopologyVariance
     {
         Constant,
@@ -97,21 +135,33 @@ namespace UnityEngine.Formats.Alembic.Sdk
     {
         public NormalsMode normalsMode { get; set; }
         public TangentsMode tangentsMode { get; set; }
+        public aiBoundsMode boundsMode { get; set; }
         public float scaleFactor { get; set; }
         public float aspectRatio { get; set; } // Broken/Unimplemented , not connected to any code path.
         public float vertexMotionScale { get; set; }
         public int splitUnit { get; set; }
+        public int workerCount { get; set; } // 1: serial update, 0 or less: all available threads
+        public int prefetchCount { get; set; } // 0: disabled
+        public ulong sampleCacheBudget { get; set; } // bytes. 0: disabled
+        public int streamCount { get; set; } // file streams opened on load. 0 or less: one per worker
         public Bool swapHandedness { get; set; }
         public Bool flipFaces { get; set; }
         public Bool interpolateSamples { get; set; }
         public Bool importPointPolygon { get; set; }
         public Bool importLinePolygon { get; set; }
         public Bool importTrianglePolygon { get; set; }
+        public Bool lazyHierarchy { get; set; }
+        public Bool hashVertexDedup { get; set; } // merge all vertices with identical attributes
+        public aiIndexFormat indexFormat { get; set; } // 16 bit indices for splits of up to 0xffff vertices
+        public aiVertexFormat vertexFormat { get; set; } // quantized normals, tangents, uv and colors
+        public Bool dirtyRanges { get; set; } // narrow dirty summaries to changed vertices
+        public Bool mapArchives { get; set; } // memory map archives on linux. the file must not be truncated while loaded
 
         public void SetDefaults()
         {
             normalsMode = NormalsMode.CalculateIfMissing;
             tangentsMode = TangentsMode.None;
+            boundsMode = aiBoundsMode.ComputeOnCook;
             scaleFactor = 0.01f;
             aspectRatio = -1.0f;
             vertexMotionScale = 1.0f;
@@ -120,12 +170,46 @@ namespace UnityEngine.Formats.Alembic.Sdk
 #else
             splitUnit = 65000;
 #endif
+            workerCount = 1;
+            prefetchCount = 0;
+            sampleCacheBudget = 0;
+            streamCount = 1;
             swapHandedness = true;
             flipFaces = false;
             interpolateSamples = true;
             importPointPolygon = true;
             importLinePolygon = true;
             importTrianglePolygon = true;
+            lazyHierarchy = false;
+            hashVertexDedup = false;
+            indexFormat = aiIndexFormat.UInt32;
+            var vf = default(aiVertexFormat);
+            vf.SetDefaults();
+            vertexFormat = vf;
+            dirtyRanges = false;
+            mapArchives = false;
+        }
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct aiSampleCacheStats
+    {
+        public ulong hitCount;
+        public ulong missCount;
+        public ulong byteSize;
+        public int entryCount;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct aiThreadPoolConfig
+    {
+        public int workerCount { get; set; } // 0 or less: hardware threads - 1
+        public Bool pinWorkers { get; set; }
+
+        public void SetDefaults()
+        {
+            workerCount = 0;
+            pinWorkers = false;
         }
     }
 
@@ -170,6 +254,14 @@ namespace UnityEngine.Formats.Alembic.Sdk
         public int vertexCount { get; set; }
         public int indexCount { get; set; }
         public Bool topologyChanged { get; set; }
+        public Bool unchangedPoints { get; set; }
+        public Bool unchangedVelocities { get; set; }
+        public Bool unchangedNormals { get; set; }
+        public Bool unchangedTangents { get; set; }
+        public Bool unchangedUV0 { get; set; }
+        public Bool unchangedUV1 { get; set; }
+        public Bool unchangedRgba { get; set; }
+        public Bool unchangedRgb { get; set; }
     }
 
     internal struct aiMeshSplitSummary
@@ -182,6 +274,28 @@ namespace UnityEngine.Formats.Alembic.Sdk
         public int indexOffset { get; set; }
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct aiVertexRange
+    {
+        public int begin; // relative to the first vertex of the split
+        public int end;
+        public bool isEmpty { get { return begin >= end; } }
+    }
+
+    // attributes changed since the last fill. whole splits unless aiConfig.dirtyRanges is enabled
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct aiMeshSplitDirtySummary
+    {
+        public aiVertexRange points;
+        public aiVertexRange velocities;
+        public aiVertexRange normals;
+        public aiVertexRange tangents;
+        public aiVertexRange uv0;
+        public aiVertexRange uv1;
+        public aiVertexRange rgba;
+        public aiVertexRange rgb;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     internal struct aiSubmeshSummary
     {
@@ -189,6 +303,39 @@ namespace UnityEngine.Formats.Alembic.Sdk
         public int submeshIndex { get; set; }
         public int indexCount { get; set; }
         public aiTopology topology { get; set; }
+        public int indexSize { get; set; } // bytes per index. 2 or 4
+    }
+
+    enum aiVertexAttribute
+    {
+        Points,
+        Velocities,
+        Normals,
+        Tangents,
+        UV0,
+        UV1,
+        RGBA,
+        RGB,
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct aiVertexElement
+    {
+        public aiVertexAttribute attribute;
+        public aiAttributeFormat format;
+        public int offset; // bytes from the start of the stream
+        public int stride; // bytes between vertices
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct aiVertexStreamData
+    {
+        public IntPtr data;
+        public IntPtr elements;
+        public int elementCount;
+
+        public Vector3 center;
+        public Vector3 extents;
     }
 
     [StructLayout(LayoutKind.Sequential)]
@@ -196,12 +343,13 @@ namespace UnityEngine.Formats.Alembic.Sdk
     {
         public IntPtr positions;
         public IntPtr velocities;
-        public IntPtr normals;
-        public IntPtr tangents;
-        public IntPtr uv0;
-        public IntPtr uv1;
-        public IntPtr rgba;
-        public IntPtr rgb;
+        // element types follow aiConfig.vertexFormat. encoded formats write their packed elements to these buffers
+        public IntPtr normals; // Vector3, or 2 x short with Oct16
+        public IntPtr tangents; // Vector4, or 4 x short with Oct16
+        public IntPtr uv0; // Vector2, or 2 x half with Half16
+        public IntPtr uv1; // Vector2, or 2 x half with Half16
+        public IntPtr rgba; // Color, or Color32 with UNorm8
+        public IntPtr rgb; // Color, or Color32 with UNorm8
         public IntPtr indices;
 
         public int vertexCount;
@@ -237,6 +385,30 @@ namespace UnityEngine.Formats.Alembic.Sdk
         public IntPtr indexes;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    struct aiBufferView
+    {
+        public IntPtr data; // zero if the sample doesn't have the attribute
+        public int count;
+        public int elementSize;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct aiPolyMeshSplitView
+    {
+        public aiBufferView points;
+        public aiBufferView velocities;
+        public aiBufferView normals;
+        public aiBufferView tangents;
+        public aiBufferView uv0;
+        public aiBufferView uv1;
+        public aiBufferView rgba;
+        public aiBufferView rgb; // 3 floats unless encoded
+
+        public Vector3 center;
+        public Vector3 extents;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     struct aiXformData
     {
@@ -329,8 +501,10 @@ namespace UnityEngine.Formats.Alembic.Sdk
 
         internal void SetConfig(ref aiConfig conf) { NativeMethods.aiContextSetConfig(self, ref conf); }
         public void UpdateSamples(double time) { NativeMethods.aiContextUpdateSamples(self, time); }
+        internal void GetSampleCacheStats(ref aiSampleCacheStats dst) { NativeMethods.aiContextGetSampleCacheStats(self, ref dst); }
 
         internal aiObject topObject { get { return NativeMethods.aiContextGetTopObject(self); } }
+        internal aiObject FindObject(string path) { return NativeMethods.aiContextFindObject(self, path); }
         public int timeSamplingCount { get { return NativeMethods.aiContextGetTimeSamplingCount(self); } }
         public aiTimeSampling GetTimeSampling(int i) { return NativeMethods.aiContextGetTimeSampling(self, i); }
         internal void GetTimeRange(out double begin, out double end) { NativeMethods.aiContextGetTimeRange(self, out begin, out end); }
@@ -419,6 +593,10 @@ namespace UnityEngine.Formats.Alembic.Sdk
 
         public aiPolyMeshSample sample { get { return NativeMethods.aiPolyMesh.aiSchemaGetSample(self); } }
         public void GetSummary(ref aiMeshSummary dst) { NativeMethods.aiPolyMeshGetSummary(self, ref dst); }
+
+        // views of the pinned sample stay valid until it is released
+        internal aiPolyMeshSample PinSample() { return NativeMethods.aiPolyMeshPinSample(self); }
+        internal void ReleaseSample(aiPolyMeshSample sample) { NativeMethods.aiPolyMeshReleaseSample(self, sample.self); }
     }
 
     [StructLayout(LayoutKind.Explicit)]
@@ -489,6 +667,14 @@ namespace UnityEngine.Formats.Alembic.Sdk
             }
         }
 
+        public void GetSplitDirtySummaries(NativeArray<aiMeshSplitDirtySummary> dst)
+        {
+            unsafe
+            {
+                NativeMethods.aiPolyMeshGetSplitDirtySummaries(self, new IntPtr(dst.GetUnsafePtr()));
+            }
+        }
+
         internal void FillVertexBuffer(NativeArray<aiPolyMeshData> vbs, NativeArray<aiSubmeshData> ibs)
         {
             unsafe
@@ -496,6 +682,39 @@ namespace UnityEngine.Formats.Alembic.Sdk
                 NativeMethods.aiPolyMeshFillVertexBuffer(self, new IntPtr(vbs.GetUnsafePtr()), new IntPtr(ibs.GetUnsafePtr()));
             }
         }
+
+        internal void FillSplitStream(int splitIndex, ref aiVertexStreamData dst)
+        {
+            NativeMethods.aiPolyMeshFillSplitStream(self, splitIndex, ref dst);
+        }
+
+        internal void GetSplitView(int splitIndex, ref aiPolyMeshSplitView dst)
+        {
+            NativeMethods.aiPolyMeshGetSplitView(self, splitIndex, ref dst);
+        }
+
+        internal void GetSubmeshView(int submeshIndex, ref aiBufferView dst)
+        {
+            NativeMethods.aiPolyMeshGetSubmeshView(self, submeshIndex, ref dst);
+        }
+
+        // vbs and ibs must not be disposed until the returned task is completed
+        internal aiAsyncTask FillVertexBufferAsync(NativeArray<aiPolyMeshData> vbs, NativeArray<aiSubmeshData> ibs)
+        {
+            unsafe
+            {
+                return new aiAsyncTask { self = NativeMethods.aiPolyMeshFillVertexBufferAsync(self, new IntPtr(vbs.GetUnsafePtr()), new IntPtr(ibs.GetUnsafePtr())) };
+            }
+        }
+    }
+
+    struct aiAsyncTask
+    {
+        public IntPtr self;
+        public static implicit operator bool(aiAsyncTask v) { return v.self != IntPtr.Zero; }
+
+        public bool isCompleted { get { return NativeMethods.aiAsyncTaskIsCompleted(self); } }
+        public void Wait() { NativeMethods.aiAsyncTaskWait(self); }
     }
 
     struct aiPointsSample